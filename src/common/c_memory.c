@@ -25,11 +25,14 @@
 
 /* When memory checking is enabled, this structure is prepended to every
    allocated block. There is also a no-mans-land chunk, filled with a specific
-   byte, at the end of every allocated block as well. */
+   byte, at the end of every allocated block as well. Tags are kept in a
+   doubly-linked list and the newest tag for each address is also kept in a
+   hash table so that they can be found quickly. */
 #define NO_MANS_LAND_BYTE 0x5a
 #define NO_MANS_LAND_SIZE 64
 typedef struct c_mem_tag {
-        struct c_mem_tag *next;
+        struct c_mem_tag *next, *prev, *hash_next;
+        struct c_mem_site *site;
         const char *alloc_file, *alloc_func, *free_file, *free_func;
         void *data;
         size_t size;
@@ -37,9 +40,143 @@ typedef struct c_mem_tag {
         char no_mans_land[NO_MANS_LAND_SIZE];
 } c_mem_tag_t;
 
-static c_mem_tag_t *mem_root;
+/* Initial size of the memory tag hash table, must be a power of two */
+#define MEM_HASH_SIZE 4096
+
+/* Allocation statistics are kept for every place in the code that allocates
+   memory while memory checking is enabled */
+typedef struct c_mem_site {
+        struct c_mem_site *next;
+        const char *file, *func;
+        size_t bytes, bytes_max;
+        int line, blocks, calls;
+} c_mem_site_t;
+
+/* Size of the allocation site hash table, must be a power of two */
+#define MEM_SITES_SIZE 1024
+
+/* Number of allocation sites printed to the log */
+#define MEM_SITES_LOGGED 20
+
+static c_mem_site_t *mem_sites[MEM_SITES_SIZE];
+static int mem_sites_len;
+
+/* Transient memory that only needs to last until the end of the frame is
+   allocated from an arena that is reset every frame. If the arena runs out,
+   more chunks are chained on and replaced by a single larger chunk at the
+   next reset. Chunks larger than the maximum are not kept. */
+#define FRAME_ALIGN 16
+#define FRAME_ARENA_SIZE 262144
+#define FRAME_ARENA_MAX 4194304
+typedef struct c_frame_chunk {
+        struct c_frame_chunk *next;
+        size_t size, used;
+} c_frame_chunk_t;
+#define FRAME_CHUNK_HEADER ((sizeof (c_frame_chunk_t) + FRAME_ALIGN - 1) & \
+                            ~(FRAME_ALIGN - 1))
+
+/* Largest number of bytes allocated from the frame arena in one frame */
+size_t c_frame_mem_high;
+
+static c_frame_chunk_t *frame_chunks;
+static size_t frame_bytes;
+
+/* Pool items are allocated in blocks of this many items. Each item is
+   prefixed by a header holding its index. */
+#define POOL_BLOCK 256
+#define POOL_HEADER 16
+
+static c_mem_tag_t *mem_root, **mem_hash;
 static size_t mem_bytes, mem_bytes_max;
-static int mem_calls;
+static int mem_calls, mem_hash_size, mem_hash_len;
+
+/******************************************************************************\
+ Adds a new chunk to the frame arena that can hold at least [size] bytes.
+\******************************************************************************/
+static void frame_chunk_alloc(size_t size)
+{
+        c_frame_chunk_t *chunk;
+
+        if (size < FRAME_ARENA_SIZE)
+                size = FRAME_ARENA_SIZE;
+        chunk = malloc(FRAME_CHUNK_HEADER + size);
+        if (!chunk)
+                C_error("Out of memory, tried to allocate %u bytes for "
+                        "the frame arena", size);
+        chunk->size = size;
+        chunk->used = 0;
+        chunk->next = frame_chunks;
+        frame_chunks = chunk;
+}
+
+/******************************************************************************\
+ Allocates [size] bytes of memory that will be valid until the end of the
+ frame. This memory is never freed with C_free() and is not tracked by
+ memory checking.
+\******************************************************************************/
+void *C_frame_alloc(size_t size)
+{
+        void *ptr;
+
+        size = (size + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+        if (!frame_chunks || frame_chunks->used + size > frame_chunks->size)
+                frame_chunk_alloc(size);
+        ptr = (char *)frame_chunks + FRAME_CHUNK_HEADER + frame_chunks->used;
+        frame_chunks->used += size;
+        frame_bytes += size;
+        if (frame_bytes > c_frame_mem_high)
+                c_frame_mem_high = frame_bytes;
+        return ptr;
+}
+
+/******************************************************************************\
+ Releases [ptr] and everything allocated from the frame arena after it early.
+ This only has an effect if [ptr] is in the newest chunk of the arena. Use it
+ when a large transient allocation is done with outside the main loop.
+\******************************************************************************/
+void C_frame_release(void *ptr)
+{
+        char *base;
+        size_t used;
+
+        if (!frame_chunks || !ptr)
+                return;
+        base = (char *)frame_chunks + FRAME_CHUNK_HEADER;
+        if ((char *)ptr < base || (char *)ptr >= base + frame_chunks->used)
+                return;
+        used = (char *)ptr - base;
+        frame_bytes -= frame_chunks->used - used;
+        frame_chunks->used = used;
+}
+
+/******************************************************************************\
+ Frees all memory allocated from the frame arena. Must be called once per
+ frame. If the arena had to grow, its chunks are replaced with one chunk
+ large enough to hold everything. A chunk larger than the maximum is never
+ kept, even if it is the only one.
+\******************************************************************************/
+void C_frame_reset(void)
+{
+        c_frame_chunk_t *next;
+        size_t size;
+
+        if (!frame_chunks)
+                return;
+        if (!frame_chunks->next && frame_chunks->size <= FRAME_ARENA_MAX) {
+                frame_chunks->used = 0;
+                frame_bytes = 0;
+                return;
+        }
+        size = frame_bytes;
+        while (frame_chunks) {
+                next = frame_chunks->next;
+                free(frame_chunks);
+                frame_chunks = next;
+        }
+        frame_bytes = 0;
+        if (size <= FRAME_ARENA_MAX)
+                frame_chunk_alloc(size);
+}
 
 /******************************************************************************\
  Initialize an array.
@@ -48,19 +185,46 @@ void C_array_init_full(c_array_t *array, int item_size, int cap)
 {
         array->item_size = item_size;
         array->len = 0;
+        array->frame = FALSE;
         if (cap < 0)
                 cap = 0;
         array->capacity = cap;
         array->data = cap > 0 ? C_malloc(cap * item_size) : 0;
 }
 
+/******************************************************************************\
+ Initialize an array that is allocated from the frame arena. The array is
+ only valid until the end of the frame and does not need to be cleaned up.
+\******************************************************************************/
+void C_array_init_frame_full(c_array_t *array, int item_size, int cap)
+{
+        array->item_size = item_size;
+        array->len = 0;
+        array->frame = TRUE;
+        if (cap < 0)
+                cap = 0;
+        array->capacity = cap;
+        array->data = cap > 0 ? C_frame_alloc(cap * item_size) : 0;
+}
+
 /******************************************************************************\
  Ensure that enough space is allocated for [n] elements.
 \******************************************************************************/
 void C_array_reserve(c_array_t *array, int n)
 {
-        array->data = C_realloc(array->data, array->item_size * n);
+        void *data;
+
         array->capacity = n;
+        if (!array->frame) {
+                array->data = C_realloc(array->data, array->item_size * n);
+                return;
+        }
+
+        /* Frame arrays leave their old data behind in the arena */
+        data = C_frame_alloc(array->item_size * n);
+        if (array->data)
+                memcpy(data, array->data, array->item_size * array->len);
+        array->data = data;
 }
 
 /******************************************************************************\
@@ -90,7 +254,11 @@ void *C_array_steal(c_array_t *array)
 {
         void *result;
 
-        result = C_realloc(array->data, array->len * array->item_size);
+        if (array->frame)
+                result = array->data;
+        else
+                result = C_realloc(array->data,
+                                   array->len * array->item_size);
         C_zero(array);
         return result;
 }
@@ -100,10 +268,291 @@ void *C_array_steal(c_array_t *array)
 \******************************************************************************/
 void C_array_cleanup(c_array_t *array)
 {
-        C_free(array->data);
+        if (!array->frame)
+                C_free(array->data);
         memset(array, 0, sizeof (*array));
 }
 
+/******************************************************************************\
+ Returns the hash table bucket for an allocated address.
+\******************************************************************************/
+static c_mem_tag_t **mem_hash_bucket(const void *ptr)
+{
+        size_t hash;
+
+        hash = (size_t)ptr / sizeof (void *);
+        hash ^= hash >> 12;
+        return mem_hash + (hash & (mem_hash_size - 1));
+}
+
+/******************************************************************************\
+ Finds the newest memory tag that holds [ptr]. Returns the link in the hash
+ table that points to the tag or NULL if there is no such tag.
+\******************************************************************************/
+static c_mem_tag_t **find_tag(const void *ptr)
+{
+        c_mem_tag_t **link;
+
+        if (!mem_hash)
+                return NULL;
+        for (link = mem_hash_bucket(ptr); *link; link = &(*link)->hash_next)
+                if ((*link)->data == ptr)
+                        return link;
+        return NULL;
+}
+
+/******************************************************************************\
+ Adds a tag to the hash table. Any older tag for the same address is removed
+ from the table, but not from the linked list.
+\******************************************************************************/
+static void hash_tag(c_mem_tag_t *tag)
+{
+        c_mem_tag_t **link, **old_hash;
+        int i, old_size;
+
+        /* Grow the table */
+        if (mem_hash_len >= mem_hash_size) {
+                old_hash = mem_hash;
+                old_size = mem_hash_size;
+                mem_hash_size = old_size ? 2 * old_size : MEM_HASH_SIZE;
+                mem_hash = calloc(mem_hash_size, sizeof (*mem_hash));
+                if (!mem_hash)
+                        C_error("Out of memory for memory tags");
+                for (i = 0; i < old_size; i++)
+                        while (old_hash[i]) {
+                                c_mem_tag_t *next;
+
+                                next = old_hash[i]->hash_next;
+                                link = mem_hash_bucket(old_hash[i]->data);
+                                old_hash[i]->hash_next = *link;
+                                *link = old_hash[i];
+                                old_hash[i] = next;
+                        }
+                free(old_hash);
+        }
+
+        /* Replace the old tag for this address */
+        if ((link = find_tag(tag->data))) {
+                tag->hash_next = (*link)->hash_next;
+                (*link)->hash_next = NULL;
+                *link = tag;
+                return;
+        }
+
+        link = mem_hash_bucket(tag->data);
+        tag->hash_next = *link;
+        *link = tag;
+        mem_hash_len++;
+}
+
+/******************************************************************************\
+ Fixes the links to a tag that has been moved by realloc().
+\******************************************************************************/
+static void relink_tag(c_mem_tag_t *tag, c_mem_tag_t **link)
+{
+        *link = tag;
+        if (tag->prev)
+                tag->prev->next = tag;
+        else
+                mem_root = tag;
+        if (tag->next)
+                tag->next->prev = tag;
+}
+
+/******************************************************************************\
+ Counts the allocated memory in [tag] toward its allocation site statistics.
+\******************************************************************************/
+static void site_add(c_mem_tag_t *tag)
+{
+        c_mem_site_t *site, **bucket;
+
+        /* Find the allocation site */
+        bucket = mem_sites + ((C_hash_djb2(tag->alloc_file) + tag->alloc_line) &
+                              (MEM_SITES_SIZE - 1));
+        for (site = *bucket; site; site = site->next)
+                if (site->line == tag->alloc_line &&
+                    site->func == tag->alloc_func &&
+                    !strcmp(site->file, tag->alloc_file))
+                        break;
+
+        /* Start tracking a new site */
+        if (!site) {
+                site = calloc(1, sizeof (*site));
+                if (!site)
+                        C_error("Out of memory for allocation sites");
+                site->file = tag->alloc_file;
+                site->func = tag->alloc_func;
+                site->line = tag->alloc_line;
+                site->next = *bucket;
+                *bucket = site;
+                mem_sites_len++;
+        }
+
+        tag->site = site;
+        site->bytes += tag->size;
+        site->blocks++;
+        site->calls++;
+        if (site->bytes > site->bytes_max)
+                site->bytes_max = site->bytes;
+}
+
+/******************************************************************************\
+ Removes the memory in [tag] from its allocation site statistics.
+\******************************************************************************/
+static void site_remove(c_mem_tag_t *tag)
+{
+        tag->site->bytes -= tag->size;
+        tag->site->blocks--;
+}
+
+/******************************************************************************\
+ Initialize a pool of items [item_size] bytes large. The [name] is only used
+ for statistics and must be static.
+\******************************************************************************/
+void C_pool_init_full(c_pool_t *pool, const char *name, int item_size)
+{
+        C_zero(pool);
+        pool->name = name;
+        pool->item_size = item_size;
+        pool->stride = (POOL_HEADER + item_size + POOL_HEADER - 1) &
+                       ~(POOL_HEADER - 1);
+}
+
+/******************************************************************************\
+ Returns the address of the slot holding item [index] in a pool.
+\******************************************************************************/
+static char *pool_slot(const c_pool_t *pool, int index)
+{
+        return (char *)pool->blocks[index / POOL_BLOCK] +
+               (index % POOL_BLOCK) * pool->stride;
+}
+
+/******************************************************************************\
+ Allocate a cleared item from a pool. Memory is only allocated when the pool
+ has no free items left.
+\******************************************************************************/
+void *C_pool_alloc(c_pool_t *pool)
+{
+        char *slot;
+        int i, index, capacity;
+
+        if (pool->stride < 1)
+                C_error("Pool '%s' is not initialized", pool->name);
+
+        /* Add a new block of items */
+        if (pool->free_len < 1) {
+                index = pool->blocks_len++;
+                capacity = pool->blocks_len * POOL_BLOCK;
+                pool->blocks = C_realloc(pool->blocks, pool->blocks_len *
+                                                       sizeof (*pool->blocks));
+                pool->blocks[index] = C_malloc(POOL_BLOCK * pool->stride);
+                pool->free = C_realloc(pool->free,
+                                       capacity * sizeof (*pool->free));
+                pool->live = C_realloc(pool->live,
+                                       capacity * sizeof (*pool->live));
+                pool->live_pos = C_realloc(pool->live_pos, capacity *
+                                                   sizeof (*pool->live_pos));
+
+                /* Lower indices are handed out first */
+                for (i = POOL_BLOCK - 1; i >= 0; i--) {
+                        pool->live_pos[index * POOL_BLOCK + i] = -1;
+                        pool->free[pool->free_len++] = index * POOL_BLOCK + i;
+                }
+        }
+
+        index = pool->free[--pool->free_len];
+        slot = pool_slot(pool, index);
+        *(int *)slot = index;
+        memset(slot + POOL_HEADER, 0, pool->item_size);
+        pool->live_pos[index] = pool->len;
+        pool->live[pool->len++] = index;
+        if (pool->len > pool->len_max)
+                pool->len_max = pool->len;
+        pool->allocs++;
+        return slot + POOL_HEADER;
+}
+
+/******************************************************************************\
+ Returns the index of an item allocated from a pool.
+\******************************************************************************/
+int C_pool_index(const void *item)
+{
+        return *(const int *)((const char *)item - POOL_HEADER);
+}
+
+/******************************************************************************\
+ Return an item to its pool. The last live item takes its place in the live
+ item list.
+\******************************************************************************/
+void C_pool_free(c_pool_t *pool, void *item)
+{
+        int index, pos, last;
+
+        if (!item)
+                return;
+        index = C_pool_index(item);
+        if (index < 0 || index >= pool->blocks_len * POOL_BLOCK ||
+            pool_slot(pool, index) + POOL_HEADER != item)
+                C_error("Item (0x%x) is not from pool '%s'", item, pool->name);
+        if ((pos = pool->live_pos[index]) < 0)
+                C_error("Item %d from pool '%s' already freed",
+                        index, pool->name);
+        last = pool->live[--pool->len];
+        pool->live[pos] = last;
+        pool->live_pos[last] = pos;
+        pool->live_pos[index] = -1;
+        pool->free[pool->free_len++] = index;
+}
+
+/******************************************************************************\
+ Returns the live item with the given [index] or NULL if it is not allocated.
+\******************************************************************************/
+void *C_pool_get(const c_pool_t *pool, int index)
+{
+        if (index < 0 || index >= pool->blocks_len * POOL_BLOCK ||
+            pool->live_pos[index] < 0)
+                return NULL;
+        return pool_slot(pool, index) + POOL_HEADER;
+}
+
+/******************************************************************************\
+ Returns the [i]th live item in a pool. Live items are not kept in any
+ particular order.
+\******************************************************************************/
+void *C_pool_live(const c_pool_t *pool, int i)
+{
+        C_assert(i >= 0 && i < pool->len);
+        return pool_slot(pool, pool->live[i]) + POOL_HEADER;
+}
+
+/******************************************************************************\
+ Prints statistics for a pool to the log.
+\******************************************************************************/
+void C_pool_stats(const c_pool_t *pool)
+{
+        C_debug("Pool '%s': %d items, %d peak, %d allocations, "
+                "%d blocks (%.1fkb)", pool->name, pool->len, pool->len_max,
+                pool->allocs, pool->blocks_len,
+                pool->blocks_len * POOL_BLOCK * pool->stride / 1024.f);
+}
+
+/******************************************************************************\
+ Free all memory used by a pool. Any items left in the pool are freed as
+ well.
+\******************************************************************************/
+void C_pool_cleanup(c_pool_t *pool)
+{
+        int i;
+
+        for (i = 0; i < pool->blocks_len; i++)
+                C_free(pool->blocks[i]);
+        C_free(pool->blocks);
+        C_free(pool->free);
+        C_free(pool->live);
+        C_free(pool->live_pos);
+        C_pool_init_full(pool, pool->name, pool->item_size);
+}
+
 /******************************************************************************\
  Allocates new memory, similar to realloc_checked().
 \******************************************************************************/
@@ -123,10 +572,13 @@ static void *malloc_checked(const char *file, int line, const char *function,
         tag->freed = FALSE;
         memset(tag->no_mans_land, NO_MANS_LAND_BYTE, NO_MANS_LAND_SIZE);
         memset((char *)tag->data + size, NO_MANS_LAND_BYTE, NO_MANS_LAND_SIZE);
-        tag->next = NULL;
+        tag->prev = NULL;
+        tag->next = mem_root;
         if (mem_root)
-                tag->next = mem_root;
+                mem_root->prev = tag;
         mem_root = tag;
+        hash_tag(tag);
+        site_add(tag);
         mem_bytes += size;
         mem_calls++;
         if (mem_bytes > mem_bytes_max)
@@ -134,24 +586,6 @@ static void *malloc_checked(const char *file, int line, const char *function,
         return tag->data;
 }
 
-/******************************************************************************\
- Finds the memory tag that holds [ptr].
-\******************************************************************************/
-static c_mem_tag_t *find_tag(const void *ptr, c_mem_tag_t **prev_tag)
-{
-        c_mem_tag_t *tag, *prev;
-
-        prev = NULL;
-        tag = mem_root;
-        while (tag && tag->data != ptr) {
-                prev = tag;
-                tag = tag->next;
-        }
-        if (prev_tag)
-                *prev_tag = prev;
-        return tag;
-}
-
 /******************************************************************************\
  Reallocate [ptr] to [size] bytes large. Abort on error. String all the
  allocated chunks into a linked list and tracks information about the
@@ -161,25 +595,26 @@ static c_mem_tag_t *find_tag(const void *ptr, c_mem_tag_t **prev_tag)
 static void *realloc_checked(const char *file, int line, const char *function,
                              void *ptr, size_t size)
 {
-        c_mem_tag_t *tag, *prev_tag, *old_tag;
+        c_mem_tag_t *tag, **link;
         size_t real_size;
 
         if (!ptr)
                 return malloc_checked(file, line, function, size);
-        if (!(tag = find_tag(ptr, &prev_tag)))
+        if (!(link = find_tag(ptr)))
                 C_error_full(file, line, function,
                              "Trying to reallocate unallocated address (0x%x)",
                              ptr);
-        old_tag = tag;
         real_size = size + sizeof (c_mem_tag_t) + NO_MANS_LAND_SIZE;
         tag = realloc((char *)ptr - sizeof (c_mem_tag_t), real_size);
         if (!tag)
                 C_error("Out of memory, %s() (%s:%d) tried to allocate %d "
                         "bytes", function, file, line, size );
-        if (prev_tag)
-                prev_tag->next = tag;
-        if (old_tag == mem_root)
-                mem_root = tag;
+
+        /* The old address is no longer allocated */
+        relink_tag(tag, link);
+        *link = tag->hash_next;
+        mem_hash_len--;
+        site_remove(tag);
         mem_bytes += size - tag->size;
         if (size > tag->size) {
                 mem_calls++;
@@ -192,6 +627,8 @@ static void *realloc_checked(const char *file, int line, const char *function,
         tag->alloc_func = function;
         tag->data = (char *)tag + sizeof (c_mem_tag_t);
         memset((char *)tag->data + size, NO_MANS_LAND_BYTE, NO_MANS_LAND_SIZE);
+        hash_tag(tag);
+        site_add(tag);
         return tag->data;
 }
 
@@ -239,7 +676,7 @@ static int check_no_mans_land(const char *ptr)
 \******************************************************************************/
 void C_free_full(const char *file, int line, const char *function, void *ptr)
 {
-        c_mem_tag_t *tag, *prev_tag, *old_tag;
+        c_mem_tag_t *tag, **link;
 
         if (!c_mem_check.value.n) {
                 free(ptr);
@@ -247,9 +684,10 @@ void C_free_full(const char *file, int line, const char *function, void *ptr)
         }
         if (!ptr)
                 return;
-        if (!(tag = find_tag(ptr, &prev_tag)))
+        if (!(link = find_tag(ptr)))
                 C_error_full(file, line, function,
                              "Trying to free unallocated address (0x%x)", ptr);
+        tag = *link;
         if (tag->freed)
                 C_error_full(file, line, function,
                              "Address (0x%x), %d bytes allocated by "
@@ -273,12 +711,9 @@ void C_free_full(const char *file, int line, const char *function, void *ptr)
         tag->free_file = file;
         tag->free_line = line;
         tag->free_func = function;
-        old_tag = tag;
         tag = realloc(tag, sizeof (*tag));
-        if (prev_tag)
-                prev_tag->next = tag;
-        if (old_tag == mem_root)
-                mem_root = tag;
+        relink_tag(tag, link);
+        site_remove(tag);
         mem_bytes -= tag->size;
 }
 
@@ -321,6 +756,84 @@ void C_check_leaks(void)
                 mem_calls, mem_bytes_max / 1048576.f, tags);
 }
 
+/******************************************************************************\
+ Comparison function for sorting allocation sites by their peak usage.
+\******************************************************************************/
+static int site_cmp(const void *a, const void *b)
+{
+        const c_mem_site_t *site_a, *site_b;
+
+        site_a = *(c_mem_site_t **)a;
+        site_b = *(c_mem_site_t **)b;
+        if (site_a->bytes_max != site_b->bytes_max)
+                return site_a->bytes_max < site_b->bytes_max ? 1 : -1;
+        return site_b->calls - site_a->calls;
+}
+
+/******************************************************************************\
+ If memory checking is enabled, dumps allocation statistics for every place
+ in the code that allocates memory, sorted by peak usage. If [filename] is
+ NULL, the largest sites are printed to the log instead of written out as
+ comma-separated values.
+\******************************************************************************/
+void C_dump_mem_sites(const char *filename)
+{
+        c_mem_site_t **sorted, *site;
+        c_file_t file;
+        int i, j;
+
+        if (!c_mem_check.value.n) {
+                if (filename)
+                        C_warning("Memory checking is not enabled");
+                return;
+        }
+
+        /* Sort the sites */
+        sorted = malloc((mem_sites_len + 1) * sizeof (*sorted));
+        if (!sorted)
+                C_error("Out of memory for allocation sites");
+        for (i = j = 0; i < MEM_SITES_SIZE; i++)
+                for (site = mem_sites[i]; site; site = site->next)
+                        sorted[j++] = site;
+        qsort(sorted, mem_sites_len, sizeof (*sorted), site_cmp);
+
+        /* Print the top sites to the log */
+        if (!filename) {
+                C_debug("%d allocation sites, largest by peak usage:",
+                        mem_sites_len);
+                for (i = 0; i < mem_sites_len && i < MEM_SITES_LOGGED; i++)
+                        C_debug("%8.1fkb peak, %8.1fkb in %5d blocks, "
+                                "%6d calls: %s() in %s:%d",
+                                sorted[i]->bytes_max / 1024.f,
+                                sorted[i]->bytes / 1024.f, sorted[i]->blocks,
+                                sorted[i]->calls, sorted[i]->func,
+                                sorted[i]->file, sorted[i]->line);
+                free(sorted);
+                return;
+        }
+
+        /* Write everything to a file */
+        if (!C_absolute_path(filename))
+                filename = C_va("%s/%s", C_user_dir(), filename);
+        if (!C_file_init_write(&file, filename)) {
+                C_warning("Failed to save allocation sites to '%s'", filename);
+                free(sorted);
+                return;
+        }
+        C_file_printf(&file, "file,line,function,peak_bytes,bytes,"
+                             "blocks,calls\n");
+        for (i = 0; i < mem_sites_len; i++)
+                C_file_printf(&file, "%s,%d,%s,%u,%u,%d,%d\n",
+                              sorted[i]->file, sorted[i]->line,
+                              sorted[i]->func,
+                              (unsigned int)sorted[i]->bytes_max,
+                              (unsigned int)sorted[i]->bytes,
+                              sorted[i]->blocks, sorted[i]->calls);
+        C_file_cleanup(&file);
+        free(sorted);
+        C_debug("Saved %d allocation sites to '%s'", mem_sites_len, filename);
+}
+
 /******************************************************************************\
  Run some test to see if memory checking actually works. Note that code here
  is intentionally poor, so do not fix "bugs" here they are there for a reason.
@@ -235,8 +235,18 @@ struct c_var {
 typedef struct c_array {
         int capacity, len, item_size;
         void *data;
+        bool frame;
 } c_array_t;
 
+/* Pools of fixed-size items. Items never move once allocated and keep the
+   same index until they are freed. Live items can be iterated densely. */
+typedef struct c_pool {
+        const char *name;
+        void **blocks;
+        int *free, *live, *live_pos;
+        int item_size, stride, blocks_len, free_len, len, len_max, allocs;
+} c_pool_t;
+
 /* A structure to hold the data for a file that is being read in tokens */
 typedef struct c_token_file {
         char filename[256], buffer[C_TOKEN_SIZE], swap, *pos, *token;
@@ -331,17 +341,33 @@ void C_array_cleanup(c_array_t *);
 #define C_array_get(ary, type, i) (((type*)(ary)->data) + i)
 #define C_array_init(ary, type, cap) \
         C_array_init_full(ary, (int)sizeof (type), cap)
+#define C_array_init_frame(ary, type, cap) \
+        C_array_init_frame_full(ary, (int)sizeof (type), cap)
+void C_array_init_frame_full(c_array_t *, int item_size, int cap);
 void C_array_init_full(c_array_t *, int item_size, int cap);
 void C_array_reserve(c_array_t *, int n);
 void *C_array_steal(c_array_t *);
 #define C_calloc(s) C_recalloc_full(__FILE__, __LINE__, __func__, NULL, s)
 void C_check_leaks(void);
+void C_dump_mem_sites(const char *filename);
 void C_endian_check(void);
+void *C_frame_alloc(size_t);
+void C_frame_release(void *);
+void C_frame_reset(void);
 #define C_free(p) C_free_full(__FILE__, __LINE__, __func__, p)
 void C_free_full(const char *file, int line, const char *function, void *ptr);
 #define C_malloc(s) C_realloc(NULL, s)
 #define C_one(s) memset(s, -1, sizeof (*(s)))
 #define C_one_buf(s) memset(s, -1, sizeof (s))
+void *C_pool_alloc(c_pool_t *);
+void C_pool_cleanup(c_pool_t *);
+void C_pool_free(c_pool_t *, void *item);
+void *C_pool_get(const c_pool_t *, int index);
+int C_pool_index(const void *item);
+#define C_pool_init(p, n, type) C_pool_init_full(p, n, (int)sizeof (type))
+void C_pool_init_full(c_pool_t *, const char *name, int item_size);
+void *C_pool_live(const c_pool_t *, int i);
+void C_pool_stats(const c_pool_t *);
 #define C_realloc(p, s) C_realloc_full(__FILE__, __LINE__, __func__, p, s)
 void *C_realloc_full(const char *file, int line, const char *function,
                      void *ptr, size_t size);
@@ -362,6 +388,8 @@ void C_test_mem_check(void);
 #define C_zero(s) memset(s, 0, sizeof (*(s)))
 #define C_zero_buf(s) memset(s, 0, sizeof (s))
 
+extern size_t c_frame_mem_high;
+
 /* c_os_posix, c_os_windows.c */
 bool C_absolute_path(const char *path);
 const char *C_app_dir(void);
@@ -415,6 +443,8 @@ int C_count_poll(c_count_t *, int interval);
 void C_count_reset(c_count_t *);
 void C_throttle_fps(void);
 void C_time_init(void);
+bool C_time_tick(int msec, float *lerp);
+int C_time_to_tick(int msec);
 void C_time_update(void);
 unsigned int C_timer(void);
 
@@ -444,6 +474,6 @@ bool C_var_unlatch(c_var_t *);
 void C_var_update_data(c_var_t *, c_var_update_f, void *);
 void C_write_autogen(void);
 
-extern c_var_t c_max_fps, c_mem_check, c_show_fps, c_test_int;
+extern c_var_t c_max_fps, c_mem_check, c_mem_dump, c_show_fps, c_test_int;
 extern int c_exit;
 
@@ -31,6 +31,14 @@ int c_frame;
 int c_frame_msec;
 float c_frame_sec;
 
+/* If the simulation falls more than this many ticks behind, the missed ticks
+   are dropped instead of being run back-to-back */
+#define TICKS_BEHIND_MAX 10
+
+/* Simulation clock run by C_time_tick() and the frame time it interrupted */
+static int tick_time, tick_frame_msec, tick_frame_time, ticks_run;
+static bool ticks_started, ticking;
+
 /******************************************************************************\
  Initializes counters and timers.
 \******************************************************************************/
@@ -59,6 +67,63 @@ void C_time_update(void)
                 C_debug("Frame %d lagged, %d msec", c_frame, c_frame_msec);
 }
 
+/******************************************************************************\
+ Runs a fixed-rate simulation of [msec] ticks alongside frames of any length.
+ Call in a loop after C_time_update() and run one simulation tick every time
+ it returns TRUE. The time is set to that of the tick while it runs. Once no
+ more ticks are due, the frame's time is restored, [lerp] is set to how far
+ the frame is between the last tick and the next and FALSE is returned.
+\******************************************************************************/
+bool C_time_tick(int msec, float *lerp)
+{
+        if (!ticks_started) {
+                tick_time = c_time_msec;
+                ticks_started = TRUE;
+        }
+        if (!ticking) {
+                tick_frame_time = c_time_msec;
+                tick_frame_msec = c_frame_msec;
+                ticks_run = 0;
+                ticking = TRUE;
+        }
+        if (tick_frame_time - tick_time >= msec) {
+                if (ticks_run < TICKS_BEHIND_MAX) {
+                        tick_time += msec;
+                        ticks_run++;
+                        c_time_msec = tick_time;
+                        c_frame_msec = msec;
+                        c_frame_sec = msec / 1000.f;
+                        return TRUE;
+                }
+                C_debug("Simulation lagged %d msec, skipping ticks",
+                        tick_frame_time - tick_time);
+                tick_time = tick_frame_time;
+        }
+
+        /* Restore the frame's time */
+        c_time_msec = tick_frame_time;
+        c_frame_msec = tick_frame_msec;
+        c_frame_sec = tick_frame_msec / 1000.f;
+        ticking = FALSE;
+        if (lerp)
+                *lerp = (float)(tick_frame_time - tick_time) / msec;
+        return FALSE;
+}
+
+/******************************************************************************\
+ Returns how many milliseconds are left until the next tick of [msec] run by
+ C_time_tick() is due. Loops with nothing else to do can sleep this long.
+\******************************************************************************/
+int C_time_to_tick(int msec)
+{
+        int wait;
+
+        if (!ticks_started)
+                return 0;
+        wait = tick_time + msec - (int)SDL_GetTicks();
+        return wait > 0 ? wait : 0;
+}
+
 /******************************************************************************\
  Returns the time since the last call to C_timer(). Useful for measuring the
  efficiency of sections of code.
@@ -11,11 +11,19 @@
 \******************************************************************************/
 
 /* This file contains the common configurable variables and the framework
-   for handling configurable variables system-wide. Variables are not set
-   or referred to by their names often, so efficiency here is not important. */
+   for handling configurable variables system-wide. Variables are kept in a
+   sorted linked list for iteration, a sorted array for prefix completion and
+   a hash table for name lookups. */
 
 #include "c_shared.h"
 
+/* Maximum number of registered variables */
+#define VARS_MAX 1024
+
+/* Size of the variable name hash table, must be a power of two and should be
+   at least twice the maximum number of variables */
+#define VARS_HASH_SIZE 2048
+
 /* Message logging */
 c_var_t c_log_level, c_log_file, c_log_throttle;
 
@@ -25,8 +33,9 @@ c_var_t c_max_fps, c_show_fps;
 
 /* We can do some detailed allocated memory tracking and detect double-free,
    memory under/overrun, and leaks on the fly. This variable cannot be changed
-   after initilization! */
-c_var_t c_mem_check;
+   after initilization! The allocation statistics can be dumped to a file
+   by setting the dump variable to a filename. */
+c_var_t c_mem_check, c_mem_dump;
 
 /* Language that should be used for translations, must restart game to apply
    changes */
@@ -39,7 +48,19 @@ c_var_t c_test_int;
 /* This should be set to TRUE when the main loop needs to exit properly */
 int c_exit;
 
-static c_var_t *root;
+static c_var_t *root, *vars_sorted[VARS_MAX], *vars_hash[VARS_HASH_SIZE];
+static int vars_len;
+
+/******************************************************************************\
+ Dumps the allocation statistics to the file named by the new value of the
+ variable. The value is never set so the same file can be dumped again.
+\******************************************************************************/
+static int mem_dump_update(c_var_t *var, c_var_value_t value)
+{
+        if (value.s[0])
+                C_dump_mem_sites(value.s);
+        return FALSE;
+}
 
 /******************************************************************************\
  Registers the common configurable variables.
@@ -67,6 +88,11 @@ void C_register_variables(void)
         /* Memory checking */
         C_register_integer(&c_mem_check, "c_mem_check", FALSE,
                            "enable to debug memory allocations");
+        C_register_string(&c_mem_dump, "c_mem_dump", "",
+                          "save allocation statistics to this CSV file");
+        c_mem_dump.archive = FALSE;
+        c_mem_dump.edit = C_VE_FUNCTION;
+        c_mem_dump.update = mem_dump_update;
 
         /* Language selection */
         C_register_string(&c_lang, "c_lang", "",
@@ -79,6 +105,51 @@ void C_register_variables(void)
         c_test_int.edit = C_VE_ANYTIME;
 }
 
+/******************************************************************************\
+ Hashes a variable name. Variable names are not case-sensitive.
+\******************************************************************************/
+static unsigned int var_hash(const char *name)
+{
+        char buf[64];
+        int i;
+
+        for (i = 0; name[i] && i < sizeof (buf) - 1; i++)
+                buf[i] = tolower(name[i]);
+        buf[i] = NUL;
+        return C_hash_djb2(buf);
+}
+
+/******************************************************************************\
+ Find the index of where a variable name is or would go in the hash table.
+\******************************************************************************/
+static int var_hash_index(const char *name)
+{
+        int i;
+
+        for (i = var_hash(name) & (VARS_HASH_SIZE - 1);
+             vars_hash[i] && strcasecmp(vars_hash[i]->name, name);
+             i = (i + 1) & (VARS_HASH_SIZE - 1));
+        return i;
+}
+
+/******************************************************************************\
+ Returns the index of the first variable in the sorted array whose name is not
+ alphabetically before [name].
+\******************************************************************************/
+static int var_sorted_index(const char *name)
+{
+        int low, high, mid;
+
+        for (low = 0, high = vars_len; low < high; ) {
+                mid = (low + high) / 2;
+                if (strcasecmp(vars_sorted[mid]->name, name) < 0)
+                        low = mid + 1;
+                else
+                        high = mid;
+        }
+        return low;
+}
+
 /******************************************************************************\
  This function will register a static configurable variable. The data is stored
  in the c_var_t [var], which is guaranteed to always have the specified
@@ -92,11 +163,17 @@ void C_register_variables(void)
 static void var_register(c_var_t *var, const char *name, c_var_type_t type,
                          c_var_value_t value, const char *comment)
 {
-        c_var_t *pos, *prev;
+        int hash_index, sorted_index;
 
         if (var->type)
                 C_error("Attempted to re-register '%s' with '%s'",
                         var->name, name);
+        if (vars_len >= VARS_MAX)
+                C_error("Too many variables registered, can't add '%s'",
+                        name);
+        hash_index = var_hash_index(name);
+        if (vars_hash[hash_index])
+                C_error("Variable name '%s' is already registered", name);
         var->type = type;
         var->name = name;
         var->comment = comment;
@@ -105,18 +182,22 @@ static void var_register(c_var_t *var, const char *name, c_var_type_t type,
         var->archive = TRUE;
         var->changed = -1;
 
-        /* Attach the var to the linked list, sorted alphabetically */
-        prev = NULL;
-        pos = root;
-        while (pos && strcasecmp(var->name, pos->name) > 0) {
-                prev = pos;
-                pos = pos->next;
-        }
-        var->next = pos;
-        if (prev)
-                prev->next = var;
-        if (pos == root)
+        /* Insert the var into the sorted array and attach it to the linked
+           list in the same order */
+        sorted_index = var_sorted_index(name);
+        memmove(vars_sorted + sorted_index + 1, vars_sorted + sorted_index,
+                (vars_len - sorted_index) * sizeof (*vars_sorted));
+        vars_sorted[sorted_index] = var;
+        vars_len++;
+        var->next = sorted_index + 1 < vars_len ?
+                    vars_sorted[sorted_index + 1] : NULL;
+        if (sorted_index > 0)
+                vars_sorted[sorted_index - 1]->next = var;
+        else
                 root = var;
+
+        /* Add the var to the hash table */
+        vars_hash[hash_index] = var;
 }
 
 void C_register_float(c_var_t *var, const char *name, float value_f,
@@ -147,21 +228,12 @@ void C_register_string(c_var_t *var, const char *name, const char *value_s,
 }
 
 /******************************************************************************\
- Tries to find variable [name] (case insensitive) in the variable linked list.
+ Tries to find variable [name] (case insensitive) in the variable hash table.
  Returns NULL if it fails.
 \******************************************************************************/
 c_var_t *C_resolve_var(const char *name)
 {
-        c_var_t *var;
-
-        var = root;
-        while (var)
-        {
-                if (!strcasecmp(var->name, name))
-                        return var;
-                var = var->next;
-        }
-        return NULL;
+        return vars_hash[var_hash_index(name)];
 }
 
 /******************************************************************************\
@@ -428,18 +500,15 @@ void C_write_autogen(void)
 const char *C_auto_complete_vars(const char *str)
 {
         static char buf[128];
-        c_var_t *var, *matches[100];
+        c_var_t **matches;
         int i, j, str_len, matches_len, common;
 
-        /* Find all cvars that match [str] */
+        /* Matching cvars are next to each other in the sorted array */
         str_len = C_strlen(str);
-        matches_len = 0;
-        for (var = root; var; var = var->next)
-                if (!strncasecmp(var->name, str, str_len)) {
-                        matches[matches_len++] = var;
-                        if (matches_len >= sizeof (matches) / sizeof (*matches))
-                                break;
-                }
+        matches = vars_sorted + var_sorted_index(str);
+        for (matches_len = 0; matches + matches_len < vars_sorted + vars_len &&
+             !strncasecmp(matches[matches_len]->name, str, str_len) &&
+             matches_len < 100; matches_len++);
         if (matches_len < 1)
                 return "";
         if (matches_len < 2) {
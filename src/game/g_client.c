@@ -179,7 +179,7 @@ static void sm_game_over(void)
 static void sm_init(void)
 {
         float variance;
-        int protocol, subdiv4, islands, island_size;
+        int protocol, subdiv4, islands, island_size, ships;
 
         C_assert(n_client_id != N_HOST_CLIENT_ID);
         G_reset_elements();
@@ -208,6 +208,13 @@ static void sm_init(void)
         I_configure_player_num(g_clients_max);
         C_debug("Client ID %d of %d", n_client_id, g_clients_max);
 
+        /* Maximum number of ships */
+        if ((ships = N_receive_short()) < 1) {
+                G_corrupt_disconnect();
+                return;
+        }
+        G_resize_ships(ships);
+
         /* Generate matching globe */
         subdiv4 = N_receive_char();
         g_globe_seed.value.n = N_receive_int();
@@ -233,7 +240,7 @@ static void sm_name(void)
         int client;
         char old_name[G_NAME_MAX];
 
-        if ((client = G_receive_cargo(-1)) < 0)
+        if ((client = G_receive_client(-1)) < 0)
                 return;
         C_strncpy_buf(old_name, g_clients[client].name);
         N_receive_string_buf(g_clients[client].name);
@@ -289,7 +296,7 @@ static void sm_ship_spawn(void)
 
         if (n_client_id == N_HOST_CLIENT_ID)
                 return;
-        index = N_receive_char();
+        index = N_receive_short();
         client = N_receive_char();
         tile = N_receive_short();
         type = N_receive_char();
@@ -298,24 +305,11 @@ static void sm_ship_spawn(void)
 }
 
 /******************************************************************************\
- Receive a ship path.
+ Update a ship's boarding state, announcing boarding actions that involve our
+ ships.
 \******************************************************************************/
-static void sm_ship_state(void)
+static void ship_boarding(int index, int boarding, int boarding_ship)
 {
-        int index, boarding, boarding_ship;
-
-        if ((index = G_receive_ship(-1)) < 0)
-                return;
-        g_ships[index].health = N_receive_char();
-        g_ships[index].store.cargo[G_CT_CREW].amount = N_receive_short();
-
-        /* Remote client boarding announcements */
-        boarding = N_receive_char();
-        boarding_ship = N_receive_char();
-        if (boarding_ship >= G_SHIPS_MAX) {
-                G_corrupt_disconnect();
-                return;
-        }
         if (boarding_ship >= 0 && g_ships[index].boarding_ship < 0 &&
             G_ship_controlled_by(index, n_client_id))
                 I_popup(&g_ships[index].model.origin,
@@ -326,10 +320,104 @@ static void sm_ship_state(void)
                 I_popup(&g_ships[index].model.origin,
                         C_va(C_str("g-boarded", "%s is being boarded!"),
                              g_ships[index].name));
+        if (g_ships[index].boarding != boarding ||
+            g_ships[index].boarding_ship != boarding_ship)
+                G_ship_wake_around(index);
         g_ships[index].boarding = boarding;
         g_ships[index].boarding_ship = boarding_ship;
 }
 
+/******************************************************************************\
+ Read the changed cargo entries of a ship from a snapshot. Price settings of
+ our own ships are not overwritten.
+\******************************************************************************/
+static void snapshot_cargo(int index)
+{
+        g_cargo_t *cargo;
+        int i, mask, fields, value;
+        bool own;
+
+        own = G_ship_controlled_by(index, n_client_id);
+        mask = N_receive_varint();
+        for (i = 0; i < G_CARGO_TYPES; i++) {
+                if (!(mask & (1 << i)))
+                        continue;
+                cargo = g_ships[index].store.cargo + i;
+                fields = N_receive_varint();
+                if (fields & (1 << G_CF_AMOUNT))
+                        cargo->amount = N_receive_varint();
+                if (fields & (1 << G_CF_BUY_PRICE)) {
+                        value = N_receive_varint();
+                        if (!own && (cargo->auto_buy = value >= 0))
+                                cargo->buy_price = value;
+                }
+                if (fields & (1 << G_CF_SELL_PRICE)) {
+                        value = N_receive_varint();
+                        if (!own && (cargo->auto_sell = value >= 0))
+                                cargo->sell_price = value;
+                }
+                if (fields & (1 << G_CF_MINIMUM)) {
+                        value = N_receive_varint();
+                        if (!own)
+                                cargo->minimum = value;
+                }
+                if (fields & (1 << G_CF_MAXIMUM)) {
+                        value = N_receive_varint();
+                        if (!own)
+                                cargo->maximum = value;
+                }
+        }
+}
+
+/******************************************************************************\
+ Receive the changed fields of every ship that changed since the last
+ snapshot. The list is terminated by a zero ship.
+\******************************************************************************/
+static void sm_snapshot(void)
+{
+        g_ship_t *ship;
+        int index, mask, boarding, boarding_ship;
+
+        if (n_client_id == N_HOST_CLIENT_ID)
+                return;
+        while ((index = N_receive_varint() - 1) >= 0) {
+                if (index >= g_ships_max || !g_ships[index].in_use) {
+                        G_corrupt_disconnect();
+                        return;
+                }
+                ship = g_ships + index;
+                mask = N_receive_varint();
+                if (mask & (1 << G_SF_HEALTH)) {
+                        ship->health = N_receive_varint();
+                        G_ship_wake_around(index);
+                }
+                if (mask & (1 << G_SF_CREW))
+                        ship->store.cargo[G_CT_CREW].amount =
+                                N_receive_varint();
+
+                /* Remote client boarding announcements */
+                boarding = ship->boarding;
+                boarding_ship = ship->boarding_ship;
+                if (mask & (1 << G_SF_BOARDING))
+                        boarding = N_receive_varint();
+                if (mask & (1 << G_SF_BOARDING_SHIP))
+                        boarding_ship = N_receive_varint();
+                if (boarding_ship < -1 || boarding_ship >= g_ships_max) {
+                        G_corrupt_disconnect();
+                        return;
+                }
+                ship_boarding(index, boarding, boarding_ship);
+
+                /* Update the cargo manifest */
+                if (mask & (1 << G_SF_CARGO))
+                        snapshot_cargo(index);
+                if (mask & (1 << G_SF_CREW | 1 << G_SF_CARGO)) {
+                        G_store_space(&ship->store);
+                        G_ship_reselect(index, -1);
+                }
+        }
+}
+
 /******************************************************************************\
  The buy/sell prices of a cargo item have changed on some ship.
 \******************************************************************************/
@@ -375,6 +463,55 @@ static int name_update(c_var_t *var, c_var_value_t value)
         return TRUE;
 }
 
+/******************************************************************************\
+ Converts a server message to a string.
+\******************************************************************************/
+const char *G_sm_to_string(g_server_msg_t msg)
+{
+        switch (msg) {
+        case G_SM_NONE:
+                return "G_SM_NONE";
+        case G_SM_CLIENT:
+                return "G_SM_CLIENT";
+        case G_SM_INIT:
+                return "G_SM_INIT";
+        case G_SM_SNAPSHOT:
+                return "G_SM_SNAPSHOT";
+        case G_SM_AFFILIATE:
+                return "G_SM_AFFILIATE";
+        case G_SM_CONNECTED:
+                return "G_SM_CONNECTED";
+        case G_SM_DISCONNECTED:
+                return "G_SM_DISCONNECTED";
+        case G_SM_NAME:
+                return "G_SM_NAME";
+        case G_SM_GAME_OVER:
+                return "G_SM_GAME_OVER";
+        case G_SM_CHAT:
+                return "G_SM_CHAT";
+        case G_SM_POPUP:
+                return "G_SM_POPUP";
+        case G_SM_SHIP_NAME:
+                return "G_SM_SHIP_NAME";
+        case G_SM_SHIP_OWNER:
+                return "G_SM_SHIP_OWNER";
+        case G_SM_SHIP_PATH:
+                return "G_SM_SHIP_PATH";
+        case G_SM_SHIP_PRICES:
+                return "G_SM_SHIP_PRICES";
+        case G_SM_SHIP_SPAWN:
+                return "G_SM_SHIP_SPAWN";
+        case G_SM_SHIP_TRANSACT:
+                return "G_SM_SHIP_TRANSACT";
+        case G_SM_BUILDING:
+                return "G_SM_BUILDING";
+        case G_SM_GIB:
+                return "G_SM_GIB";
+        default:
+                return C_va("%d", msg);
+        }
+}
+
 /******************************************************************************\
  Client network event callback function.
 \******************************************************************************/
@@ -415,6 +552,11 @@ void G_client_callback(int client, n_event_t event)
         if (event != N_EV_MESSAGE)
                 return;
         token = N_receive_char();
+
+        /* Debug messages */
+        if (g_debug_net.value.n)
+                C_trace("%s from server", G_sm_to_string(token));
+
         switch (token) {
         case G_SM_POPUP:
                 sm_popup();
@@ -425,6 +567,9 @@ void G_client_callback(int client, n_event_t event)
         case G_SM_INIT:
                 sm_init();
                 break;
+        case G_SM_SNAPSHOT:
+                sm_snapshot();
+                break;
         case G_SM_NAME:
                 sm_name();
                 break;
@@ -440,26 +585,10 @@ void G_client_callback(int client, n_event_t event)
         case G_SM_SHIP_SPAWN:
                 sm_ship_spawn();
                 break;
-        case G_SM_SHIP_STATE:
-                sm_ship_state();
-                break;
         case G_SM_SHIP_PRICES:
                 sm_ship_prices();
                 break;
 
-        /* A ship's cargo manifest changed */
-        case G_SM_SHIP_CARGO:
-                if ((i = G_receive_ship(-1)) < 0)
-                        return;
-                if (n_client_id != N_HOST_CLIENT_ID) {
-                        bool own;
-
-                        own = G_ship_controlled_by(i, n_client_id);
-                        G_store_receive(&g_ships[i].store, own);
-                }
-                G_ship_reselect(i, -1);
-                break;
-
         /* A gib spawned or vanished */
         case G_SM_GIB:
                 if (n_client_id == N_HOST_CLIENT_ID ||
@@ -473,6 +602,7 @@ void G_client_callback(int client, n_event_t event)
                 if (n_client_id == N_HOST_CLIENT_ID ||
                     (i = G_receive_ship(-1)) < 0)
                         return;
+                G_ship_wake(i);
                 G_ship_move_to(i, N_receive_short());
                 g_ships[i].progress = N_receive_float();
                 N_receive_string_buf(g_ships[i].path);
@@ -505,6 +635,7 @@ void G_client_callback(int client, n_event_t event)
                                            "Captured the %s."),
                                      g_ships[i].name));
                 g_ships[i].client = j;
+                G_ship_wake_around(i);
                 G_ship_reselect(i, -1);
                 break;
 
@@ -549,12 +680,21 @@ void G_client_callback(int client, n_event_t event)
 }
 
 /******************************************************************************\
- Called to update client-side structures.
+ Called once per frame to handle the client's network traffic. Messages are
+ not held back until the next simulation tick.
 \******************************************************************************/
 void G_update_client(void)
 {
         N_poll_client();
         N_poll_http();
+}
+
+/******************************************************************************\
+ Called once per simulation tick to advance the game.
+\******************************************************************************/
+void G_update_tick(void)
+{
+        G_update_host();
         if (i_limbo)
                 return;
         G_update_ships();
@@ -567,6 +707,8 @@ void G_init(void)
 {
         C_status("Initializing client");
         G_init_elements();
+        G_init_pools();
+        G_test_paths();
         G_init_globe();
 
         /* Update the server when our name changes */
@@ -574,6 +716,10 @@ void G_init(void)
         g_name.update = (c_var_update_f)name_update;
         g_name.edit = C_VE_FUNCTION;
 
+        /* Label network statistics with message names */
+        N_stats_names((n_message_name_f)G_sm_to_string,
+                      (n_message_name_f)G_cm_to_string);
+
         /* Parse names config */
         G_load_names();
 }
@@ -583,8 +729,10 @@ void G_init(void)
 \******************************************************************************/
 void G_cleanup(void)
 {
-        G_cleanup_ships();
+        G_resize_ships(0);
         G_cleanup_tiles();
+        G_cleanup_pools();
+        G_cleanup_globe();
 }
 
 /******************************************************************************\
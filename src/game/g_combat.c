@@ -47,8 +47,10 @@ static void start_boarding(int ship)
         /* Start a boarding attack */
         g_ships[ship].boarding_ship = target_ship;
         g_ships[ship].boarding++;
-        g_ships[ship].modified = TRUE;
+        G_snapshot_modified(ship);
         g_ships[target_ship].boarding++;
+        G_ship_wake_around(ship);
+        G_ship_wake_around(target_ship);
 
         /* Host boarding announcements */
         if (G_ship_controlled_by(ship, n_client_id))
@@ -98,8 +100,10 @@ static bool ship_board_attack(int ship, int defender, int power)
         }
 
         /* Send a full status update */
-        g_ships[ship].modified = TRUE;
-        g_ships[defender].modified = TRUE;
+        G_snapshot_modified(ship);
+        G_snapshot_modified(defender);
+        G_ship_wake_around(ship);
+        G_ship_wake_around(defender);
 
         return TRUE;
 }
@@ -55,7 +55,7 @@ static void ship_ring(i_ring_icon_t icon)
 {
         if (g_selected_ship < 0 || ring_ship < 0 || g_game_over)
                 return;
-        N_send(N_SERVER_ID, "1111", G_CM_SHIP_RING, g_selected_ship,
+        N_send(N_SERVER_ID, "1212", G_CM_SHIP_RING, g_selected_ship,
                icon, ring_ship);
 }
 
@@ -105,7 +105,7 @@ bool G_process_click(int button)
 
                 /* Ordered an ocean move */
                 if (g_hover_tile >= 0 && G_tile_open(g_hover_tile, -1))
-                        N_send(N_SERVER_ID, "112", G_CM_SHIP_MOVE,
+                        N_send(N_SERVER_ID, "122", G_CM_SHIP_MOVE,
                                g_selected_ship, g_hover_tile);
 
                 /* Right-clicked on another ship */
@@ -233,7 +233,7 @@ void G_trade_params(g_cargo_type_t index, int buy_price, int sell_price,
                 return;
 
         /* Tell the server */
-        N_send(N_SERVER_ID, "1112222", G_CM_SHIP_PRICES, g_selected_ship,
+        N_send(N_SERVER_ID, "1212222", G_CM_SHIP_PRICES, g_selected_ship,
                index, buy_price, sell_price, minimum, maximum);
 }
 
@@ -259,7 +259,7 @@ void G_buy_cargo(g_cargo_type_t cargo, int amount)
                                         cargo, amount)))
                 return;
 
-        N_send(N_SERVER_ID, "11212", G_CM_SHIP_BUY, g_selected_ship,
+        N_send(N_SERVER_ID, "12212", G_CM_SHIP_BUY, g_selected_ship,
                ship->trade_tile, cargo, amount);
 }
 
@@ -277,7 +277,7 @@ void G_drop_cargo(g_cargo_type_t cargo, int amount)
         ship = g_ships + g_selected_ship;
         if (g_selected_ship < 0)
                 return;
-        N_send(N_SERVER_ID, "1112", G_CM_SHIP_DROP, g_selected_ship,
+        N_send(N_SERVER_ID, "1212", G_CM_SHIP_DROP, g_selected_ship,
                cargo, amount);
 }
 
@@ -18,16 +18,17 @@
 
 /* Network protocol used by the client and server. Increment when no longer
    compatible before releasing a new version of the game.*/
-#define G_PROTOCOL 4
+#define G_PROTOCOL 7
 
 /* Invalid island index */
-#define G_ISLAND_INVALID 255
+#define G_ISLAND_INVALID -1
 
-/* Maximum number of islands. Do not set this value above G_ISLAND_INVALID. */
-#define G_ISLAND_NUM 128
+/* Most ships a game can be hosted with. Ship indices are sent as shorts. */
+#define G_SHIPS_LIMIT 32767
 
-/* Maximum number of ships in a game */
-#define G_SHIPS_MAX 128
+/* Bit of a client in a mask of clients. Masks are unsigned ints, so there can
+   be no more than 32 clients. */
+#define G_client_bit(c) ((c) >= 0 && (c) < N_CLIENTS_MAX ? 1u << (c) : 0u)
 
 /* Length of a name */
 #define G_NAME_MAX 16
@@ -65,6 +66,7 @@ typedef enum {
         /* Synchronization messages */
         G_SM_CLIENT,
         G_SM_INIT,
+        G_SM_SNAPSHOT,
 
         /* Messages for when clients change status */
         G_SM_AFFILIATE,
@@ -78,13 +80,11 @@ typedef enum {
         G_SM_POPUP,
 
         /* Entity updates */
-        G_SM_SHIP_CARGO,
         G_SM_SHIP_NAME,
         G_SM_SHIP_OWNER,
         G_SM_SHIP_PATH,
         G_SM_SHIP_PRICES,
         G_SM_SHIP_SPAWN,
-        G_SM_SHIP_STATE,
         G_SM_SHIP_TRANSACT,
         G_SM_BUILDING,
         G_SM_GIB,
@@ -92,6 +92,33 @@ typedef enum {
         G_SERVER_MESSAGES
 } g_server_msg_t;
 
+/* Ship fields in a snapshot message. Cargo is last and is followed by the
+   fields of each changed cargo entry. */
+typedef enum {
+        G_SF_HEALTH,
+        G_SF_CREW,
+        G_SF_BOARDING,
+        G_SF_BOARDING_SHIP,
+        G_SF_CARGO,
+} g_snapshot_field_t;
+
+/* Cargo entry fields in a snapshot message */
+typedef enum {
+        G_CF_AMOUNT,
+        G_CF_BUY_PRICE,
+        G_CF_SELL_PRICE,
+        G_CF_MINIMUM,
+        G_CF_MAXIMUM,
+        G_CARGO_FIELDS
+} g_cargo_field_t;
+
+/* How closely a client follows an entity */
+typedef enum {
+        G_INTEREST_NONE,
+        G_INTEREST_REDUCED,
+        G_INTEREST_FULL,
+} g_interest_t;
+
 /* Ship types */
 typedef enum {
         G_ST_NONE,
@@ -133,12 +160,14 @@ typedef struct g_cargo {
         bool auto_buy, auto_sell;
 } g_cargo_t;
 
-/* Trading store structure */
+/* Trading store structure. [visible] is a mask of the clients that can see
+   the store's cargo, one bit per client. [ship] is the ship that carries the
+   store or -1. */
 typedef struct g_store {
         g_cargo_t cargo[G_CARGO_TYPES];
-        int modified;
+        unsigned int visible;
+        int ship;
         short space_used, capacity;
-        bool visible[N_CLIENTS_MAX];
 } g_store_t;
 
 /* Structure to represent resource cost */
@@ -158,7 +187,7 @@ typedef struct g_building {
         g_building_type_t type;
         g_nation_name_t nation;
         r_model_t model;
-        int gold, health;
+        int gold, health, tile;
 } g_building_t;
 
 /* Structure for the remains of ships */
@@ -166,14 +195,15 @@ typedef struct g_gib {
         g_gib_type_t type;
         g_cost_t loot;
         r_model_t model;
+        int tile;
 } g_gib_t;
 
 /* A tile on the globe */
 typedef struct g_tile {
         g_building_t *building;
         g_gib_t *gib;
-        int island, ship, search_parent, search_stamp;
-        bool visible;
+        int island, region, ship, search_parent, search_stamp, search_moves;
+        bool visible, search_closed;
 } g_tile_t;
 
 /* Structure for each player */
@@ -191,17 +221,21 @@ typedef struct g_ship_base {
         int health, cargo;
 } g_ship_class_t;
 
-/* Structure containing ship information */
+/* Structure containing ship information. The ship's [origin] and [normal]
+   are where it is as of the last simulation tick and [last_origin] and
+   [last_normal] where it was the tick before. The model is placed between
+   them. The ship's [visible_stale] flag is set when the visibility of its store
+   needs to be recomputed. */
 typedef struct g_ship {
         g_ship_type_t type;
         g_store_t store;
         r_model_t model;
-        c_vec3_t forward;
+        c_vec3_t forward, last_normal, last_origin, normal, origin;
         float progress;
         int boarding, boarding_ship, client, combat_time, focus_stamp, health,
             lunch_time, rear_tile, target, target_ship, tile, trade_tile;
         char path[R_PATH_MAX], name[G_NAME_MAX];
-        bool in_use, modified, target_board;
+        bool in_use, target_board, visible_stale;
 } g_ship_t;
 
 /* Island structure */
@@ -212,6 +246,7 @@ typedef struct g_island {
 /* g_client.c */
 void G_client_callback(int client, n_event_t);
 i_color_t G_nation_to_color(g_nation_name_t);
+const char *G_sm_to_string(g_server_msg_t);
 
 extern g_client_t g_clients[N_CLIENTS_MAX + 1];
 
@@ -224,21 +259,42 @@ extern g_ship_class_t g_ship_classes[G_SHIP_TYPES];
 extern g_building_class_t g_building_classes[G_BUILDING_TYPES];
 
 /* g_globe.c */
+void G_cleanup_globe(void);
 void G_init_globe(void);
 void G_generate_globe(int subdiv4, int islands, int island_size,
                       float variance);
 
-extern g_island_t g_islands[G_ISLAND_NUM];
+extern g_island_t *g_islands;
 extern int g_islands_len;
 
 /* g_host.c */
+const char *G_cm_to_string(g_client_msg_t);
+
 extern bool g_host_inited;
 
+/* g_interest.c */
+void G_init_interest(void);
+void G_interest_cleanup_client(n_client_id_t);
+void G_interest_reset(n_client_id_t);
+void G_resize_interest(int ships);
+void G_ship_broadcast_path(int ship);
+g_interest_t G_ship_interest(int ship, n_client_id_t);
+void G_tile_broadcast_building(int tile);
+void G_tile_broadcast_gib(int tile);
+g_interest_t G_tile_interest(int tile, n_client_id_t);
+bool G_update_interest(void);
+
 /* g_movement.c */
+void G_init_paths(void);
 bool G_ship_move_to(int ship, int new_tile);
 void G_ship_path(int ship, int tile);
 void G_ship_send_path(n_client_id_t, int ship);
 void G_ship_update_move(int i);
+void G_test_paths(void);
+bool G_tile_reachable(int from, int target, bool next_to);
+
+extern c_count_t g_count_paths_kept, g_count_paths_repaired,
+                 g_count_paths_searched;
 
 /* g_names.c */
 void G_count_name(g_name_type_t, const char *name);
@@ -247,10 +303,23 @@ void G_get_name(g_name_type_t, char *buffer, int buffer_size);
 void G_load_names(void);
 void G_reset_name_counts(void);
 
+/* g_schedule.c */
+void G_reset_schedule(void);
+void G_resize_schedule(int ships);
+void G_ship_wake(int ship);
+void G_ship_wake_around(int ship);
+void G_ship_wake_at(int ship, int time);
+void G_ship_wake_tile(int tile);
+void G_sleep_ships(void);
+void G_wake_ships(void);
+
+extern int *g_awake_ships, g_awake_len;
+
 /* g_ship.c */
 void G_cleanup_ships(void);
 void G_focus_next_ship(void);
 void G_render_ships(void);
+void G_resize_ships(int ships);
 bool G_ship_can_trade_with(int ship, int tile);
 void G_ship_change_client(int ship, n_client_id_t);
 void G_ship_collect_gib(int ship);
@@ -260,16 +329,22 @@ bool G_ship_hostile(int ship, n_client_id_t to);
 void G_ship_hover(int ship);
 void G_ship_reselect(int ship, n_client_id_t);
 void G_ship_select(int ship);
-void G_ship_send_cargo(int ship, n_client_id_t);
 void G_ship_send_name(int index, n_client_id_t);
-void G_ship_send_state(int ship, n_client_id_t);
 void G_ship_send_spawn(int index, n_client_id_t);
 int G_ship_spawn(int ship, n_client_id_t, int tile, g_ship_type_t);
 void G_ship_update_combat(int ship);
 void G_update_ships(void);
 
-extern g_ship_t g_ships[G_SHIPS_MAX];
-extern int g_hover_ship, g_selected_ship;
+extern g_ship_t *g_ships;
+extern int g_hover_ship, g_selected_ship, g_ships_max;
+
+/* g_snapshot.c */
+void G_resize_snapshot(int ships);
+void G_snapshot_cleanup_client(n_client_id_t);
+void G_snapshot_init_client(n_client_id_t);
+void G_snapshot_modified(int ship);
+void G_snapshot_reset(int ship, n_client_id_t);
+void G_snapshot_send(bool refresh);
 
 /* g_sync.c */
 #define G_corrupt_disconnect() G_corrupt_drop(N_SERVER_ID)
@@ -294,7 +369,9 @@ int G_receive_tile_full(const char *file, int line, const char *func,
                         n_client_id_t);
 
 /* g_tile.c */
+void G_cleanup_pools(void);
 void G_cleanup_tiles(void);
+void G_init_pools(void);
 void G_tile_build(int tile, g_building_type_t, g_nation_name_t);
 int G_tile_gib(int tile, g_gib_type_t);
 void G_tile_hover(int tile);
@@ -305,8 +382,9 @@ bool G_tile_open(int tile, int exclude_ship);
 void G_tile_position_model(int tile, r_model_t *);
 int G_random_open_tile(void);
 
+extern c_pool_t g_building_pool, g_gib_pool;
 extern g_tile_t g_tiles[R_TILES_MAX];
-extern int g_gibs, g_hover_tile, g_selected_tile;
+extern int g_hover_tile, g_selected_tile;
 
 /* g_trade.c */
 int G_build_time(const g_cost_t *);
@@ -319,14 +397,14 @@ int G_store_add(g_store_t *, g_cargo_type_t, int amount);
 void G_store_add_cost(g_store_t *, const g_cost_t *);
 int G_store_fits(const g_store_t *, g_cargo_type_t);
 void G_store_init(g_store_t *, int capacity);
-void G_store_receive(g_store_t *, bool ignore_prices);
 void G_store_select_clients(const g_store_t *);
-void G_store_send(g_store_t *, bool force);
+#define G_store_visible(s, c) ((s)->visible & G_client_bit(c))
 int G_store_space(g_store_t *);
 
 /* g_variables.c */
 extern c_var_t g_forest, g_debug_net, g_globe_seed, g_globe_subdiv4,
                g_island_num, g_island_size, g_island_variance,
                g_master, g_master_url, g_name, g_nation_colors[G_NATION_NAMES],
-               g_players, g_test_globe, g_time_limit, g_victory_gold;
+               g_players, g_ship_num, g_test_globe, g_test_paths,
+               g_time_limit, g_victory_gold;
 
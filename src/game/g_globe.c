@@ -30,8 +30,8 @@
 /* Distance that models fade out */
 #define MODEL_FADE_DIST 4.f
 
-/* Array of islands */
-g_island_t g_islands[G_ISLAND_NUM];
+/* Array of islands, sized for the globe being played */
+g_island_t *g_islands;
 int g_islands_len;
 
 static float visible_range;
@@ -240,8 +240,10 @@ static void grow_islands(int num, int island_size, float variance)
 
         if (num < 1 || island_size < 1)
                 return;
-        if (num > G_ISLAND_NUM)
-                num = G_ISLAND_NUM;
+        if (num > r_tiles_max)
+                num = r_tiles_max;
+        C_free(g_islands);
+        g_islands = C_calloc(num * sizeof (*g_islands));
         if (island_size > ISLAND_SIZE)
                 island_size = ISLAND_SIZE;
         C_debug("Growing %d, %d-tile islands", num, island_size);
@@ -254,6 +256,16 @@ static void grow_islands(int num, int island_size, float variance)
         }
 }
 
+/******************************************************************************\
+ Free the islands.
+\******************************************************************************/
+void G_cleanup_globe(void)
+{
+        C_free(g_islands);
+        g_islands = NULL;
+        g_islands_len = 0;
+}
+
 /******************************************************************************\
  One-time globe initialization. Call after rendering has been initialized.
 \******************************************************************************/
@@ -326,6 +338,8 @@ void G_generate_globe(int subdiv4, int override_islands, int override_size,
 
         /* This call actually raises the tiles to match terrain height */
         R_configure_globe();
+        G_init_paths();
+        G_init_interest();
 
         /* Deselect everything */
         g_hover_tile = g_selected_tile = -1;
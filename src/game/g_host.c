@@ -21,15 +21,32 @@
 /* Milliseconds between master server heartbeats */
 #define PUBLISH_INTERVAL 300000
 
+/* Milliseconds between path update statistics */
+#define PATH_STATS_INTERVAL 10000
+
+/* Milliseconds between network compression statistics */
+#define COMPRESS_STATS_INTERVAL 10000
+
 /* This game's client limit */
 int g_clients_max;
 
 /* TRUE if the server has finished initializing */
 bool g_host_inited;
 
+/* TRUE for a dedicated server, whose own client is not a player */
+bool g_headless;
+
 /* Time at which game ends */
 int g_time_limit_msec;
 
+/******************************************************************************\
+ Returns the number of connected players.
+\******************************************************************************/
+static int players_num(void)
+{
+        return g_headless ? n_clients_num - 1 : n_clients_num;
+}
+
 /******************************************************************************\
  Handles clients changing nations.
 \******************************************************************************/
@@ -137,7 +154,7 @@ static void cm_ship_name(int client)
         if (!new_name[0])
                 return;
         C_strncpy_buf(g_ships[index].name, new_name);
-        N_broadcast_except(client, "11s", G_SM_SHIP_NAME, index,
+        N_broadcast_except(client, "12s", G_SM_SHIP_NAME, index,
                            g_ships[index].name);
         C_debug("'%s' named ship %d '%s'", g_clients[client].name,
                 index, new_name);
@@ -180,7 +197,7 @@ static void cm_ship_prices(int client)
         /* Originating client already knows what the prices are */
         n_clients[client].selected = FALSE;
 
-        N_send_selected("1112222", G_SM_SHIP_PRICES, index, cargo,
+        N_send_selected("1212222", G_SM_SHIP_PRICES, index, cargo,
                         buy_price, sell_price, minimum, maximum);
 }
 
@@ -222,6 +239,10 @@ static void cm_ship_buy(int client)
                 G_store_add(buyer, G_CT_GOLD, gold);
                 G_store_add(seller, cargo, amount);
         }
+
+        /* Either ship may have gained crew that needs feeding */
+        G_ship_wake(ship);
+        G_ship_wake(trade_ship);
 }
 
 /******************************************************************************\
@@ -342,6 +363,7 @@ static void cm_ship_ring(int client)
         }
 
         g_ships[ship].target_ship = target_ship;
+        G_ship_wake(ship);
         G_ship_path(ship, g_ships[target_ship].tile);
 }
 
@@ -358,8 +380,8 @@ static void init_client(int client)
 
         /* This client has already been counted toward the total, kick them
            if this is more players than we want */
-        if (n_clients_num > g_clients_max) {
-                N_send(client, "12ss", G_SM_POPUP,
+        if (players_num() > g_clients_max) {
+                N_send(client, "12ss", G_SM_POPUP, -1,
                        "g-host-full", "Server is full.");
                 N_drop_client(client);
                 return;
@@ -369,11 +391,19 @@ static void init_client(int client)
         C_zero(g_clients + client);
 
         /* Communicate the globe info */
-        N_send(client, "12111422ff4", G_SM_INIT, G_PROTOCOL, client,
-               g_clients_max, g_globe_subdiv4.value.n, g_globe_seed.value.n,
-               g_island_num.value.n, g_island_size.value.n,
-               g_island_variance.value.f, r_solar_angle,
-               g_time_limit_msec - c_time_msec);
+        N_send(client, "121121422ff4", G_SM_INIT, G_PROTOCOL, client,
+               g_clients_max, g_ships_max, g_globe_subdiv4.value.n,
+               g_globe_seed.value.n, g_island_num.value.n,
+               g_island_size.value.n, g_island_variance.value.f,
+               r_solar_angle, g_time_limit_msec - c_time_msec);
+
+        /* Clients that accepted our protocol can read compressed batches, so
+           the rest of the game state is compressed */
+        N_compress_client(client, TRUE);
+
+        /* They are about to be sent everything they could have missed */
+        G_interest_reset(client);
+        G_snapshot_init_client(client);
 
         /* Tell them about everyone already here */
         for (i = 0; i < N_CLIENTS_MAX; i++)
@@ -382,21 +412,25 @@ static void init_client(int client)
                                g_clients[i].nation, g_clients[i].name);
 
         /* Tell them about the buildings and gibs on them globe */
-        for (i = 0; i < r_tiles_max; i++) {
-                if (g_tiles[i].building)
-                        G_tile_send_building(i, client);
-                if (g_tiles[i].gib)
-                        G_tile_send_gib(i, client);
+        for (i = 0; i < g_building_pool.len; i++) {
+                g_building_t *building;
+
+                building = C_pool_live(&g_building_pool, i);
+                G_tile_send_building(building->tile, client);
+        }
+        for (i = 0; i < g_gib_pool.len; i++) {
+                g_gib_t *gib;
+
+                gib = C_pool_live(&g_gib_pool, i);
+                G_tile_send_gib(gib->tile, client);
         }
 
         /* Tell them about all the ships on the globe */
-        for (i = 0; i < G_SHIPS_MAX; i++) {
+        for (i = 0; i < g_ships_max; i++) {
                 if (!g_ships[i].in_use)
                         continue;
                 G_ship_send_spawn(i, client);
                 G_ship_send_name(i, client);
-                if (!g_ships[i].modified)
-                        G_ship_send_state(i, client);
                 G_ship_send_path(i, client);
         }
 }
@@ -461,7 +495,7 @@ static void publish_game_alive(bool force)
         N_send_post(g_master_url.value.s,
                     "protocol", C_va("%d", G_PROTOCOL),
                     "name", g_name.value.s,
-                    "info", C_va("%d/%d, %d min", n_clients_num, g_clients_max,
+                    "info", C_va("%d/%d, %d min", players_num(), g_clients_max,
                                  (g_time_limit_msec - c_time_msec) / 60000),
                     "port", C_va("%d", n_port.value.n));
 }
@@ -481,13 +515,17 @@ static void client_disconnected(int client)
                 return;
         }
 
+        /* Their copies of the ship tables are no longer needed */
+        G_interest_cleanup_client(client);
+        G_snapshot_cleanup_client(client);
+
         /* Let everyone know about it */
         if (g_clients[client].name[0])
                 N_broadcast("111", G_SM_DISCONNECTED, client,
                             g_clients[client].kicked);
 
         /* Disown their ships */
-        for (i = 0; i < G_SHIPS_MAX; i++)
+        for (i = 0; i < g_ships_max; i++)
                 if (g_ships[i].client == client)
                         G_ship_change_client(i, N_SERVER_ID);
 }
@@ -495,7 +533,7 @@ static void client_disconnected(int client)
 /******************************************************************************\
  Converts a client message to a string.
 \******************************************************************************/
-static const char *cm_to_string(g_client_msg_t msg)
+const char *G_cm_to_string(g_client_msg_t msg)
 {
         switch (msg) {
         case G_CM_NONE:
@@ -551,7 +589,7 @@ static void server_callback(int client, n_event_t event)
 
         /* Debug messages */
         if (g_debug_net.value.n)
-                C_trace("%s from client %d", cm_to_string(token), client);
+                C_trace("%s from client %d", G_cm_to_string(token), client);
 
         /* Only certain messages allowed when the game is over */
         if (g_game_over)
@@ -655,6 +693,14 @@ void G_host_game(void)
                 g_players.value.n = N_CLIENTS_MAX;
         I_configure_player_num(g_clients_max = g_players.value.n);
 
+        /* Maximum number of ships */
+        C_var_unlatch(&g_ship_num);
+        if (g_ship_num.value.n < 1)
+                g_ship_num.value.n = 1;
+        if (g_ship_num.value.n > G_SHIPS_LIMIT)
+                g_ship_num.value.n = G_SHIPS_LIMIT;
+        G_resize_ships(g_ship_num.value.n);
+
         /* Start the network server */
         if (!N_start_server((n_callback_f)server_callback,
                             (n_callback_f)G_client_callback)) {
@@ -750,7 +796,7 @@ static void check_game_over(void)
                 g_nations[i].gold = 0;
 
         /* Count ships */
-        for (i = 0; i < G_SHIPS_MAX; i++) {
+        for (i = 0; i < g_ships_max; i++) {
                 n_client_id_t client;
 
                 if (!g_ships[i].in_use || g_ships[i].health <= 0)
@@ -829,7 +875,7 @@ void G_update_host(void)
         N_poll_server();
 
         /* Spawn crates for the players */
-        while (g_gibs < CRATES_MAX) {
+        while (g_gib_pool.len < CRATES_MAX) {
                 g_cost_t *loot;
                 int tile;
 
@@ -848,5 +894,29 @@ void G_update_host(void)
 
         check_game_over();
         publish_game_alive(FALSE);
+
+        /* Log how often ship paths have been kept, repaired or searched */
+        if (C_count_poll(&g_count_paths_searched, PATH_STATS_INTERVAL)) {
+                C_debug("Paths per second: %.1f kept, %.1f repaired, "
+                        "%.1f searched",
+                        C_count_per_sec(&g_count_paths_kept),
+                        C_count_per_sec(&g_count_paths_repaired),
+                        C_count_per_sec(&g_count_paths_searched));
+                C_count_reset(&g_count_paths_kept);
+                C_count_reset(&g_count_paths_repaired);
+                C_count_reset(&g_count_paths_searched);
+        }
+
+        /* Log how well outgoing messages compress */
+        if (C_count_poll(&n_count_compressed, COMPRESS_STATS_INTERVAL) &&
+            n_count_compressed.value > 0.f) {
+                C_debug("Compressed %.1f kb/s to %.1f kb/s (%.0f%%)",
+                        C_count_per_sec(&n_count_uncompressed) / 1024.f,
+                        C_count_per_sec(&n_count_compressed) / 1024.f,
+                        100.f * n_count_compressed.value /
+                        n_count_uncompressed.value);
+                C_count_reset(&n_count_compressed);
+                C_count_reset(&n_count_uncompressed);
+        }
 }
 
@@ -0,0 +1,468 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* Decides how closely each client follows each ship and tile based on where
+   that client's own ships are. Updates to entities near a client's ships are
+   sent right away, those further off once per interest update and those on
+   the far side of the globe not until the client gets closer. */
+
+#include "g_common.h"
+
+/* Milliseconds between interest updates. Entities of reduced interest are
+   updated this often. */
+#define INTEREST_INTERVAL 1000
+
+/* Distance from the nearest of a client's ships, in globe radii, within which
+   entities are of full or reduced interest */
+#define INTEREST_FULL 0.5f
+#define INTEREST_REDUCED 1.2f
+
+/* The globe is divided into cells by projecting it onto a cube and splitting
+   each face into a grid of this many cells on a side */
+#define CELL_DIVS 4
+#define CELLS (6 * CELL_DIVS * CELL_DIVS)
+
+/* Interest of every connected client in every ship */
+static g_interest_t *ship_interest[N_CLIENTS_MAX];
+
+/* Positions of each client's ships as of the last interest update, sorted by
+   cell. Each cell's positions start at its entry in [client_cells] and the
+   last entry is the total. Only the cells listed in [client_occupied] have
+   any. */
+static c_vec3_t *client_origins[N_CLIENTS_MAX];
+static int client_cells[N_CLIENTS_MAX][CELLS + 1],
+           client_occupied[N_CLIENTS_MAX][CELLS],
+           client_occupied_len[N_CLIENTS_MAX];
+
+/* Pairs of cells close enough to hold things of reduced interest to each
+   other on the current globe */
+static bool cells_near[CELLS][CELLS];
+
+/* Bitmasks of the clients that have missed an update */
+static unsigned int *path_stale, building_stale[R_TILES_MAX],
+                    gib_stale[R_TILES_MAX];
+
+static int interest_time;
+
+/******************************************************************************\
+ Returns the cell that [origin] is in.
+\******************************************************************************/
+static int cell_at(c_vec3_t origin)
+{
+        float ax, ay, az, u, v;
+        int face, iu, iv;
+
+        ax = fabsf(origin.x);
+        ay = fabsf(origin.y);
+        az = fabsf(origin.z);
+        if (ax >= ay && ax >= az && ax > 0.f) {
+                face = origin.x < 0.f;
+                u = origin.y / ax;
+                v = origin.z / ax;
+        } else if (ay >= az && ay > 0.f) {
+                face = 2 + (origin.y < 0.f);
+                u = origin.x / ay;
+                v = origin.z / ay;
+        } else if (az > 0.f) {
+                face = 4 + (origin.z < 0.f);
+                u = origin.x / az;
+                v = origin.y / az;
+        } else
+                return 0;
+        iu = (int)((u + 1.f) * CELL_DIVS / 2);
+        iv = (int)((v + 1.f) * CELL_DIVS / 2);
+        if (iu >= CELL_DIVS)
+                iu = CELL_DIVS - 1;
+        if (iv >= CELL_DIVS)
+                iv = CELL_DIVS - 1;
+        return (face * CELL_DIVS + iu) * CELL_DIVS + iv;
+}
+
+/******************************************************************************\
+ Returns the direction of a point in [cell]. The point is given in grid
+ units from the cell's corner.
+\******************************************************************************/
+static c_vec3_t cell_point(int cell, float u, float v)
+{
+        float sign;
+        int face;
+
+        face = cell / (CELL_DIVS * CELL_DIVS);
+        u = 2.f * (cell / CELL_DIVS % CELL_DIVS + u) / CELL_DIVS - 1.f;
+        v = 2.f * (cell % CELL_DIVS + v) / CELL_DIVS - 1.f;
+        sign = face & 1 ? -1.f : 1.f;
+        if (face < 2)
+                return C_vec3_norm(C_vec3(sign, u, v));
+        if (face < 4)
+                return C_vec3_norm(C_vec3(u, sign, v));
+        return C_vec3_norm(C_vec3(u, v, sign));
+}
+
+/******************************************************************************\
+ Returns the angle between two directions.
+\******************************************************************************/
+static float angle_between(c_vec3_t a, c_vec3_t b)
+{
+        float dot;
+
+        dot = C_vec3_dot(a, b);
+        if (dot > 1.f)
+                dot = 1.f;
+        if (dot < -1.f)
+                dot = -1.f;
+        return acosf(dot);
+}
+
+/******************************************************************************\
+ Find which cells are close enough to each other to hold things of reduced
+ interest to each other. Tiles sit at different heights, so cells are
+ compared by direction as if every origin were as low as the lowest one,
+ which can only bring them closer. Must be called whenever the globe is
+ regenerated.
+\******************************************************************************/
+void G_init_interest(void)
+{
+        c_vec3_t centers[CELLS];
+        float radius, dist, reach, radii[CELLS], angle;
+        int i, j;
+
+        for (radius = r_globe_radius, i = 0; i < r_tiles_max; i++) {
+                dist = C_vec3_len(r_tiles[i].origin);
+                if (dist < radius)
+                        radius = dist;
+        }
+
+        /* Largest angle between two origins within reduced distance */
+        reach = INTEREST_REDUCED * r_globe_radius / (2.f * radius);
+        reach = reach < 1.f ? 2.f * asinf(reach) : C_PI;
+
+        /* Cells are convex, so no point in one is further from its center
+           than the furthest corner */
+        for (i = 0; i < CELLS; i++) {
+                centers[i] = cell_point(i, 0.5f, 0.5f);
+                for (radii[i] = 0.f, j = 0; j < 4; j++) {
+                        angle = angle_between(centers[i],
+                                              cell_point(i, j & 1, j >> 1));
+                        if (angle > radii[i])
+                                radii[i] = angle;
+                }
+        }
+        for (i = 0; i < CELLS; i++)
+                for (j = 0; j < CELLS; j++)
+                        cells_near[i][j] = angle_between(centers[i],
+                                                         centers[j]) <=
+                                           reach + radii[i] + radii[j] +
+                                           0.001f;
+}
+
+/******************************************************************************\
+ Returns how interested [client] is in something at [origin]. Only the
+ client's ships in cells near the origin are checked.
+\******************************************************************************/
+static g_interest_t interest_at(n_client_id_t client, c_vec3_t origin)
+{
+        c_vec3_t diff;
+        float dist_sq, full_sq, reduced_sq;
+        int i, j, cell, near;
+        g_interest_t interest;
+
+        /* Clients without ships have nothing to be close to */
+        if (!client_origins[client] || !client_cells[client][CELLS])
+                return G_INTEREST_REDUCED;
+
+        full_sq = INTEREST_FULL * r_globe_radius;
+        full_sq *= full_sq;
+        reduced_sq = INTEREST_REDUCED * r_globe_radius;
+        reduced_sq *= reduced_sq;
+        interest = G_INTEREST_NONE;
+        cell = cell_at(origin);
+        for (i = 0; i < client_occupied_len[client]; i++) {
+                near = client_occupied[client][i];
+                if (!cells_near[cell][near])
+                        continue;
+                for (j = client_cells[client][near];
+                     j < client_cells[client][near + 1]; j++) {
+                        diff = C_vec3_sub(client_origins[client][j], origin);
+                        dist_sq = C_vec3_dot(diff, diff);
+                        if (dist_sq <= full_sq)
+                                return G_INTEREST_FULL;
+                        if (dist_sq <= reduced_sq)
+                                interest = G_INTEREST_REDUCED;
+                }
+        }
+        return interest;
+}
+
+/******************************************************************************\
+ Returns how interested [client] is in updates about [ship].
+\******************************************************************************/
+g_interest_t G_ship_interest(int ship, n_client_id_t client)
+{
+        if (client == N_HOST_CLIENT_ID || client < 0 ||
+            client >= N_CLIENTS_MAX || g_game_over ||
+            g_ships[ship].client == client)
+                return G_INTEREST_FULL;
+        if (!ship_interest[client])
+                return G_INTEREST_NONE;
+        return ship_interest[client][ship];
+}
+
+/******************************************************************************\
+ Returns how interested [client] is in updates about [tile].
+\******************************************************************************/
+g_interest_t G_tile_interest(int tile, n_client_id_t client)
+{
+        if (client == N_HOST_CLIENT_ID || client < 0 ||
+            client >= N_CLIENTS_MAX || g_game_over)
+                return G_INTEREST_FULL;
+        return interest_at(client, r_tiles[tile].origin);
+}
+
+/******************************************************************************\
+ Called when a client joins and is sent the whole game. Whatever the previous
+ client in this slot missed no longer matters. The client's tables are only
+ allocated while it is connected.
+\******************************************************************************/
+void G_interest_reset(n_client_id_t client)
+{
+        unsigned int mask;
+        int i;
+
+        C_assert(N_CLIENTS_MAX <= 32);
+        if (g_ships_max < 1)
+                return;
+        if (!ship_interest[client])
+                ship_interest[client] = C_calloc(g_ships_max *
+                                                 sizeof (*ship_interest[0]));
+        if (!client_origins[client])
+                client_origins[client] = C_calloc(g_ships_max *
+                                                  sizeof (*client_origins[0]));
+        mask = ~(1u << client);
+        for (i = 0; i < g_ships_max; i++) {
+                ship_interest[client][i] = G_INTEREST_REDUCED;
+                path_stale[i] &= mask;
+        }
+        for (i = 0; i < r_tiles_max; i++) {
+                building_stale[i] &= mask;
+                gib_stale[i] &= mask;
+        }
+        C_zero_buf(client_cells[client]);
+        client_occupied_len[client] = 0;
+}
+
+/******************************************************************************\
+ Free a client's interest tables when it disconnects.
+\******************************************************************************/
+void G_interest_cleanup_client(n_client_id_t client)
+{
+        if (client < 0 || client >= N_CLIENTS_MAX)
+                return;
+        C_free(ship_interest[client]);
+        C_free(client_origins[client]);
+        ship_interest[client] = NULL;
+        client_origins[client] = NULL;
+        C_zero_buf(client_cells[client]);
+        client_occupied_len[client] = 0;
+}
+
+/******************************************************************************\
+ Size the per-ship interest tables for [ships] ships. Pass zero to free them.
+ Client tables are thrown out and allocated again as clients are
+ reinitialized.
+\******************************************************************************/
+void G_resize_interest(int ships)
+{
+        int i;
+
+        C_free(path_stale);
+        path_stale = NULL;
+        if (ships > 0)
+                path_stale = C_calloc(ships * sizeof (*path_stale));
+        for (i = 0; i < N_CLIENTS_MAX; i++)
+                G_interest_cleanup_client(i);
+}
+
+/******************************************************************************\
+ Select the remote clients with at least [min] interest in [ship] or [tile]
+ and mark the rest in [stale]. If [only_stale] is TRUE, clients that are not
+ already marked are left alone. Returns TRUE if any client was selected.
+\******************************************************************************/
+static bool select_interested(int ship, int tile, g_interest_t min,
+                              unsigned int *stale, bool only_stale)
+{
+        g_interest_t interest;
+        int i;
+        bool selected;
+
+        for (selected = FALSE, i = 0; i < N_CLIENTS_MAX; i++) {
+                n_clients[i].selected = FALSE;
+                if (i == N_HOST_CLIENT_ID || !n_clients[i].connected ||
+                    (only_stale && !(*stale & (1u << i))))
+                        continue;
+                interest = ship >= 0 ? G_ship_interest(ship, i) :
+                                       G_tile_interest(tile, i);
+                if (interest < min) {
+                        *stale |= 1u << i;
+                        continue;
+                }
+                *stale &= ~(1u << i);
+                n_clients[i].selected = TRUE;
+                selected = TRUE;
+        }
+        return selected;
+}
+
+/******************************************************************************\
+ Send a ship's new path to the clients following it closely. Everyone else
+ gets the latest path at the next interest update that finds them
+ interested.
+\******************************************************************************/
+void G_ship_broadcast_path(int ship)
+{
+        if (n_client_id != N_HOST_CLIENT_ID)
+                return;
+        if (select_interested(ship, -1, G_INTEREST_FULL, path_stale + ship,
+                              FALSE))
+                G_ship_send_path(ship, N_SELECTED_ID);
+}
+
+/******************************************************************************\
+ Send a tile's changed building or gib to every client that is interested
+ in the tile at all. Buildings and gibs change rarely, so there is no point
+ in holding them back from clients of reduced interest.
+\******************************************************************************/
+void G_tile_broadcast_building(int tile)
+{
+        if (select_interested(-1, tile, G_INTEREST_REDUCED,
+                              building_stale + tile, FALSE))
+                G_tile_send_building(tile, N_SELECTED_ID);
+}
+
+void G_tile_broadcast_gib(int tile)
+{
+        if (select_interested(-1, tile, G_INTEREST_REDUCED, gib_stale + tile,
+                              FALSE))
+                G_tile_send_gib(tile, N_SELECTED_ID);
+}
+
+/******************************************************************************\
+ Returns the client whose ship positions [ship] belongs with or -1 if it does
+ not count toward anyone's interest.
+\******************************************************************************/
+static int origin_client(int ship)
+{
+        int client;
+
+        if (!g_ships[ship].in_use)
+                return -1;
+        client = g_ships[ship].client;
+        if (client < 0 || client >= N_CLIENTS_MAX || !client_origins[client])
+                return -1;
+        return client;
+}
+
+/******************************************************************************\
+ Recompute every client's interest in every ship.
+\******************************************************************************/
+static void update_ship_interest(void)
+{
+        c_vec3_t origin;
+        int i, j, client, cell, total;
+
+        /* Count each client's ships in each cell */
+        C_zero_buf(client_cells);
+        for (i = 0; i < g_ships_max; i++) {
+                if ((client = origin_client(i)) < 0)
+                        continue;
+                cell = cell_at(r_tiles[g_ships[i].tile].origin);
+                client_cells[client][cell]++;
+        }
+
+        /* Turn the counts into where each cell ends and list the cells that
+           have any ships in them */
+        for (i = 0; i < N_CLIENTS_MAX; i++) {
+                client_occupied_len[i] = 0;
+                for (total = j = 0; j < CELLS; j++) {
+                        if (client_cells[i][j])
+                                client_occupied[i][client_occupied_len[i]++] =
+                                        j;
+                        total += client_cells[i][j];
+                        client_cells[i][j] = total;
+                }
+                client_cells[i][CELLS] = total;
+        }
+
+        /* Filling each cell from its end leaves its entry at its start */
+        for (i = 0; i < g_ships_max; i++) {
+                if ((client = origin_client(i)) < 0)
+                        continue;
+                origin = r_tiles[g_ships[i].tile].origin;
+                cell = cell_at(origin);
+                client_origins[client][--client_cells[client][cell]] = origin;
+        }
+        for (i = 0; i < N_CLIENTS_MAX; i++) {
+                if (i == N_HOST_CLIENT_ID || !n_clients[i].connected ||
+                    !ship_interest[i])
+                        continue;
+                for (j = 0; j < g_ships_max; j++)
+                        if (g_ships[j].in_use)
+                                ship_interest[i][j] =
+                                        interest_at(i, r_tiles[g_ships[j].
+                                                               tile].origin);
+        }
+}
+
+/******************************************************************************\
+ Send the updates that clients missed to the ones that are now interested.
+\******************************************************************************/
+static void send_stale(void)
+{
+        int i;
+
+        for (i = 0; i < g_ships_max; i++) {
+                if (!path_stale[i])
+                        continue;
+                if (!g_ships[i].in_use) {
+                        path_stale[i] = 0;
+                        continue;
+                }
+                if (select_interested(i, -1, G_INTEREST_REDUCED,
+                                      path_stale + i, TRUE))
+                        G_ship_send_path(i, N_SELECTED_ID);
+        }
+        for (i = 0; i < r_tiles_max; i++) {
+                if (building_stale[i] &&
+                    select_interested(-1, i, G_INTEREST_REDUCED,
+                                      building_stale + i, TRUE))
+                        G_tile_send_building(i, N_SELECTED_ID);
+                if (gib_stale[i] &&
+                    select_interested(-1, i, G_INTEREST_REDUCED,
+                                      gib_stale + i, TRUE))
+                        G_tile_send_gib(i, N_SELECTED_ID);
+        }
+}
+
+/******************************************************************************\
+ Called once per host update. Periodically recomputes interest and catches up
+ clients on what they missed. Returns TRUE if interest was updated, in which
+ case entities of reduced interest should be updated too.
+\******************************************************************************/
+bool G_update_interest(void)
+{
+        if (n_client_id != N_HOST_CLIENT_ID ||
+            c_time_msec - interest_time < INTEREST_INTERVAL)
+                return FALSE;
+        interest_time = c_time_msec;
+        update_ship_interest();
+        send_stale();
+        return TRUE;
+}
@@ -14,9 +14,6 @@
 
 #include "g_common.h"
 
-/* Maximum breadth of a path search */
-#define SEARCH_BREADTH (R_PATH_MAX * 3)
-
 /* Proportion of the remaining rotation a ship does per second */
 #define ROTATION_RATE 3.f
 
@@ -28,20 +25,404 @@
 /* This is the minimum speed a ship can have */
 #define MINIMUM_SPEED 0.25f
 
+/* Maximum number of tiles in a water region */
+#define REGION_SIZE 64
+
+/* How many moves around a blocked tile on a ship's path can be replaced when
+   repairing the path and how many tiles the repair search may expand */
+#define REPAIR_WINDOW 8
+#define REPAIR_SEARCH 256
+
+/* Results of trying to reuse a ship's path */
+typedef enum {
+        PATH_INVALID,
+        PATH_KEPT,
+        PATH_REPAIRED,
+} path_reuse_t;
+
 /* Structure for searched tile nodes */
 typedef struct search_node {
-        float dist;
+        float cost;
         int tile, moves;
 } search_node_t;
 
+/* The open list is kept as a binary heap. A tile can only be pushed once for
+   each of its neighbors, so the heap can never hold more than this. */
+static search_node_t search_heap[R_TILES_MAX * 3 + 1];
+
+/* Counts how ship paths are updated */
+c_count_t g_count_paths_kept, g_count_paths_repaired, g_count_paths_searched;
+static int search_heap_len, search_stamp, search_expanded;
+
+/* Unit direction of every tile and the inverse of the longest move between
+   two neighbors, cached when the globe is generated */
+static c_vec3_t search_dirs[R_TILES_MAX];
+static float search_step_inv;
+
+/* Bit mask for each tile of the neighbor directions that are crossed by a
+   land bridge, cached when the globe is generated */
+static unsigned char search_bridges[R_TILES_MAX];
+
+/* Water regions are small connected groups of water tiles. Long paths are
+   planned across the graph of regions before being searched tile by tile. */
+typedef struct nav_region {
+        float cost;
+        int seed, component, edges, edges_len, parent, stamp, corridor;
+        bool closed;
+} nav_region_t;
+
+/* Edges between neighboring regions, sorted by the region they start from.
+   The portal is the tile the edge crosses from. */
+typedef struct nav_edge {
+        float cost;
+        int from, to, portal;
+} nav_edge_t;
+
+static nav_region_t nav_regions[R_TILES_MAX];
+static nav_edge_t nav_edges[R_TILES_MAX * 3];
+static int nav_regions_len, nav_edges_len, nav_components, nav_stamp,
+           nav_corridor, nav_queue[R_TILES_MAX];
+
 /******************************************************************************\
- Returns the linear distance from one tile to another. This is the search
- function heuristic.
+ Returns the minimum number of moves it could take to get from one tile to
+ another. This is the search function heuristic.
 \******************************************************************************/
 static float tile_dist(int a, int b)
 {
-        return C_vec3_len(C_vec3_sub(r_tiles[b].origin,
-                                     r_tiles[a].origin));
+        return C_vec3_len(C_vec3_sub(search_dirs[b], search_dirs[a])) *
+               search_step_inv;
+}
+
+/******************************************************************************\
+ Returns TRUE if search node [a] should be expanded before [b]. Ties are
+ broken in favor of the node that has made more progress.
+\******************************************************************************/
+static bool search_node_less(const search_node_t *a, const search_node_t *b)
+{
+        if (a->cost != b->cost)
+                return a->cost < b->cost;
+        return a->moves > b->moves;
+}
+
+/******************************************************************************\
+ Add a node to the open list heap.
+\******************************************************************************/
+static void search_push(int tile, int moves, float cost)
+{
+        search_node_t node;
+        int i, parent;
+
+        C_assert(search_heap_len < sizeof (search_heap) /
+                                   sizeof (*search_heap));
+        node.tile = tile;
+        node.moves = moves;
+        node.cost = cost;
+        for (i = search_heap_len++; i > 0; i = parent) {
+                parent = (i - 1) / 2;
+                if (!search_node_less(&node, search_heap + parent))
+                        break;
+                search_heap[i] = search_heap[parent];
+        }
+        search_heap[i] = node;
+}
+
+/******************************************************************************\
+ Remove and return the cheapest node from the open list heap.
+\******************************************************************************/
+static search_node_t search_pop(void)
+{
+        search_node_t top, last;
+        int i, child;
+
+        C_assert(search_heap_len > 0);
+        top = search_heap[0];
+        last = search_heap[--search_heap_len];
+        for (i = 0; (child = 2 * i + 1) < search_heap_len; i = child) {
+                if (child + 1 < search_heap_len &&
+                    search_node_less(search_heap + child + 1,
+                                     search_heap + child))
+                        child++;
+                if (!search_node_less(search_heap + child, &last))
+                        break;
+                search_heap[i] = search_heap[child];
+        }
+        search_heap[i] = last;
+        return top;
+}
+
+/******************************************************************************\
+ Returns TRUE if a land bridge blocks the move from [tile] to its neighbor
+ with index [n].
+\******************************************************************************/
+static bool tile_bridged(int tile, int n)
+{
+        return (search_bridges[tile] & (1 << n)) != 0;
+}
+
+/******************************************************************************\
+ Comparison function for sorting region edges.
+\******************************************************************************/
+static int nav_edge_cmp(const void *a, const void *b)
+{
+        const nav_edge_t *edge_a = a, *edge_b = b;
+
+        if (edge_a->from != edge_b->from)
+                return edge_a->from - edge_b->from;
+        return edge_a->to - edge_b->to;
+}
+
+/******************************************************************************\
+ Grows a new water region out from the [seed] tile.
+\******************************************************************************/
+static void grow_region(int seed)
+{
+        int i, tile, region, queue_len, queue_pos, neighbors[3];
+
+        region = nav_regions_len++;
+        C_zero(nav_regions + region);
+        nav_regions[region].seed = seed;
+        nav_regions[region].component = -1;
+        g_tiles[seed].region = region;
+        nav_queue[0] = seed;
+        for (queue_pos = 0, queue_len = 1; queue_pos < queue_len; queue_pos++) {
+                tile = nav_queue[queue_pos];
+                R_tile_neighbors(tile, neighbors);
+                for (i = 0; i < 3 && queue_len < REGION_SIZE; i++) {
+                        if (g_tiles[neighbors[i]].region >= 0 ||
+                            !R_water_terrain(r_tiles[neighbors[i]].terrain) ||
+                            tile_bridged(tile, i))
+                                continue;
+                        g_tiles[neighbors[i]].region = region;
+                        nav_queue[queue_len++] = neighbors[i];
+                }
+        }
+}
+
+/******************************************************************************\
+ Labels every region reachable from [region] as part of a new body of water.
+\******************************************************************************/
+static void label_component(int region)
+{
+        nav_edge_t *edge;
+        int i, queue_len, queue_pos;
+
+        nav_regions[region].component = nav_components;
+        nav_queue[0] = region;
+        for (queue_pos = 0, queue_len = 1; queue_pos < queue_len; queue_pos++) {
+                region = nav_queue[queue_pos];
+                edge = nav_edges + nav_regions[region].edges;
+                for (i = 0; i < nav_regions[region].edges_len; i++, edge++) {
+                        if (nav_regions[edge->to].component >= 0)
+                                continue;
+                        nav_regions[edge->to].component = nav_components;
+                        nav_queue[queue_len++] = edge->to;
+                }
+        }
+        nav_components++;
+}
+
+/******************************************************************************\
+ Caches tile data used by path searches and builds the coarse water region
+ graph. Must be called whenever the globe is regenerated.
+\******************************************************************************/
+void G_init_paths(void)
+{
+        float step, step_max;
+        int i, j, region, neighbors[3];
+
+        for (i = 0; i < r_tiles_max; i++)
+                search_dirs[i] = C_vec3_norm(r_tiles[i].origin);
+
+        /* Find the longest move so that the heuristic never overestimates the
+           number of moves remaining */
+        for (step_max = 0.f, i = 0; i < r_tiles_max; i++) {
+                R_tile_neighbors(i, neighbors);
+                search_bridges[i] = 0;
+                for (j = 0; j < 3; j++) {
+                        step = C_vec3_len(C_vec3_sub(search_dirs[neighbors[j]],
+                                                     search_dirs[i]));
+                        if (step > step_max)
+                                step_max = step;
+                        if (R_land_bridge(i, neighbors[j]))
+                                search_bridges[i] |= 1 << j;
+                }
+        }
+        search_step_inv = step_max > 0.f ? 1.f / step_max : 0.f;
+
+        /* Partition the water into regions */
+        nav_regions_len = 0;
+        for (i = 0; i < r_tiles_max; i++)
+                g_tiles[i].region = -1;
+        for (i = 0; i < r_tiles_max; i++)
+                if (g_tiles[i].region < 0 &&
+                    R_water_terrain(r_tiles[i].terrain))
+                        grow_region(i);
+
+        /* Find the portals between regions */
+        nav_edges_len = 0;
+        for (i = 0; i < r_tiles_max; i++) {
+                if ((region = g_tiles[i].region) < 0)
+                        continue;
+                R_tile_neighbors(i, neighbors);
+                for (j = 0; j < 3; j++) {
+                        nav_edge_t *edge;
+                        int to;
+
+                        to = g_tiles[neighbors[j]].region;
+                        if (to < 0 || to == region || tile_bridged(i, j))
+                                continue;
+                        edge = nav_edges + nav_edges_len++;
+                        edge->from = region;
+                        edge->to = to;
+                        edge->portal = i;
+                        edge->cost = tile_dist(nav_regions[region].seed, i) +
+                                     tile_dist(i, nav_regions[to].seed);
+                }
+        }
+
+        /* Sort the edges and keep the cheapest portal between each pair of
+           regions */
+        qsort(nav_edges, nav_edges_len, sizeof (*nav_edges), nav_edge_cmp);
+        for (j = 0, i = 1; i < nav_edges_len; i++) {
+                if (nav_edges[i].from == nav_edges[j].from &&
+                    nav_edges[i].to == nav_edges[j].to) {
+                        if (nav_edges[i].cost < nav_edges[j].cost)
+                                nav_edges[j] = nav_edges[i];
+                        continue;
+                }
+                nav_edges[++j] = nav_edges[i];
+        }
+        if (nav_edges_len > 0)
+                nav_edges_len = j + 1;
+        for (i = nav_edges_len - 1; i >= 0; i--) {
+                nav_regions[nav_edges[i].from].edges = i;
+                nav_regions[nav_edges[i].from].edges_len++;
+        }
+
+        /* Label connected bodies of water */
+        nav_components = 0;
+        for (i = 0; i < nav_regions_len; i++)
+                if (nav_regions[i].component < 0)
+                        label_component(i);
+        C_debug("%d water regions, %d portals, %d bodies of water",
+                nav_regions_len, nav_edges_len, nav_components);
+}
+
+/******************************************************************************\
+ Returns the body of water a tile is in or -1 if it is on land.
+\******************************************************************************/
+static int tile_component(int tile)
+{
+        if (g_tiles[tile].region < 0)
+                return -1;
+        return nav_regions[g_tiles[tile].region].component;
+}
+
+/******************************************************************************\
+ Returns TRUE if a ship on the [from] tile could ever sail to the [target]
+ tile, or next to it if [next_to] is TRUE, ignoring other ships.
+\******************************************************************************/
+bool G_tile_reachable(int from, int target, bool next_to)
+{
+        int i, component, neighbors[3];
+
+        if ((component = tile_component(from)) < 0)
+                return FALSE;
+        if (tile_component(target) == component)
+                return TRUE;
+        if (!next_to)
+                return FALSE;
+        R_tile_neighbors(target, neighbors);
+        for (i = 0; i < 3; i++)
+                if (tile_component(neighbors[i]) == component)
+                        return TRUE;
+        return FALSE;
+}
+
+/******************************************************************************\
+ Plans a route across the region graph from the [from] tile toward the
+ [target] tile and marks the regions along it, and their neighbors, as the
+ corridor the tile search is limited to. Returns FALSE if the route is too
+ short to bother or no route was found.
+\******************************************************************************/
+static bool plan_corridor(int from, int target)
+{
+        nav_region_t *region;
+        nav_edge_t *edge;
+        search_node_t node;
+        float cost, dist;
+        int i, goal, start, seed, neighbors[3];
+
+        /* Find a region for land targets from their neighbors */
+        if ((start = g_tiles[from].region) < 0)
+                return FALSE;
+        if ((goal = g_tiles[target].region) < 0) {
+                R_tile_neighbors(target, neighbors);
+                for (i = 0; i < 3; i++)
+                        if (tile_component(neighbors[i]) ==
+                            nav_regions[start].component) {
+                                goal = g_tiles[neighbors[i]].region;
+                                break;
+                        }
+        }
+        if (goal < 0 || start == goal)
+                return FALSE;
+
+        /* Search the region graph */
+        nav_stamp++;
+        search_heap_len = 0;
+        seed = nav_regions[goal].seed;
+        region = nav_regions + start;
+        region->stamp = nav_stamp;
+        region->parent = -1;
+        region->cost = 0.f;
+        region->closed = FALSE;
+        search_push(start, 0, tile_dist(region->seed, seed));
+        while (search_heap_len > 0) {
+                node = search_pop();
+                region = nav_regions + node.tile;
+                if (region->closed)
+                        continue;
+                region->closed = TRUE;
+                if (node.tile == goal)
+                        break;
+                edge = nav_edges + region->edges;
+                for (i = 0; i < region->edges_len; i++, edge++) {
+                        nav_region_t *next;
+
+                        next = nav_regions + edge->to;
+                        cost = region->cost + edge->cost;
+                        if (next->stamp == nav_stamp &&
+                            (next->closed || next->cost <= cost))
+                                continue;
+                        next->stamp = nav_stamp;
+                        next->parent = node.tile;
+                        next->cost = cost;
+                        next->closed = FALSE;
+                        dist = tile_dist(next->seed, seed);
+                        search_push(edge->to, node.moves + 1, cost + dist);
+                }
+        }
+        if (nav_regions[goal].stamp != nav_stamp ||
+            !nav_regions[goal].closed)
+                return FALSE;
+
+        /* Neighboring regions don't need a corridor */
+        if (nav_regions[goal].parent == start)
+                return FALSE;
+
+        /* Mark the corridor */
+        nav_corridor++;
+        for (i = goal; i >= 0; i = nav_regions[i].parent) {
+                int j;
+
+                region = nav_regions + i;
+                region->corridor = nav_corridor;
+                edge = nav_edges + region->edges;
+                for (j = 0; j < region->edges_len; j++, edge++)
+                        nav_regions[edge->to].corridor = nav_corridor;
+        }
+        return TRUE;
 }
 
 /******************************************************************************\
@@ -60,9 +441,10 @@ static int farthest_path_tile(int ship)
                 if (next <= 0)
                         return tile;
                 R_tile_neighbors(tile, neighbors);
-                next = neighbors[next - 1];
-                if (!G_tile_open(next, ship) || R_land_bridge(tile, next))
+                if (!G_tile_open(neighbors[next - 1], ship) ||
+                    tile_bridged(tile, next - 1))
                         return tile;
+                next = neighbors[next - 1];
         }
 }
 
@@ -75,7 +457,7 @@ static bool ship_leaving_tile(int tile)
 
         C_assert(tile >= 0 && tile < r_tiles_max);
         ship = g_tiles[tile].ship;
-        if (ship >= 0 && ship < G_SHIPS_MAX &&
+        if (ship >= 0 && ship < g_ships_max &&
             g_ships[ship].tile != g_ships[ship].rear_tile &&
             tile == g_ships[ship].rear_tile)
                 return TRUE;
@@ -89,24 +471,222 @@ void G_ship_send_path(int ship, n_client_id_t client)
 {
         if (!g_ships[ship].in_use)
                 return;
-        N_send(client, "112fs", G_SM_SHIP_PATH,
+        N_send(client, "122fs", G_SM_SHIP_PATH,
                ship, g_ships[ship].tile, g_ships[ship].progress,
                g_ships[ship].path);
 }
 
+/******************************************************************************\
+ Search for a path from the [from] tile to the [target] tile for [ship]. If
+ [target_next] is TRUE, the search ends on a tile next to the target instead
+ of on it. If [corridor] is TRUE, only tiles in the planned corridor of
+ regions are searched. If [limit] is positive, the search gives up after
+ expanding that many tiles. Returns the last tile of the path or -1 if the
+ target cannot be reached. The path can be followed back from the returned
+ tile through the tiles' search parents.
+\******************************************************************************/
+static int path_search(int ship, int from, int target, bool target_next,
+                       bool corridor, int limit)
+{
+        float bias;
+        int i, expanded, neighbors[3];
+
+        /* Getting next to the target takes one move less */
+        bias = target_next ? 1.f : 0.f;
+
+        /* Start with just the initial tile open */
+        search_stamp++;
+        search_heap_len = 0;
+        g_tiles[from].search_stamp = search_stamp;
+        g_tiles[from].search_parent = -1;
+        g_tiles[from].search_moves = 0;
+        g_tiles[from].search_closed = FALSE;
+        search_push(from, 0, 0.f);
+
+        for (expanded = 0; search_heap_len > 0; expanded++) {
+                search_node_t node;
+
+                /* Skip nodes that were pushed again with fewer moves and
+                   have already been expanded */
+                node = search_pop();
+                if (g_tiles[node.tile].search_closed)
+                        continue;
+                g_tiles[node.tile].search_closed = TRUE;
+                search_expanded++;
+                if (limit > 0 && expanded >= limit)
+                        return -1;
+
+                /* Made it onto the target */
+                if (node.tile == target)
+                        return node.tile;
+
+                /* Add its children */
+                R_tile_neighbors(node.tile, neighbors);
+                for (i = 0; i < 3; i++) {
+                        g_tile_t *tile;
+                        float dist;
+                        int stamp;
+
+                        /* Made it to an adjacent tile */
+                        if (target_next && neighbors[i] == target)
+                                return node.tile;
+
+                        /* Already reached this tile with as few moves? */
+                        tile = g_tiles + neighbors[i];
+                        stamp = tile->search_stamp;
+                        C_assert(stamp <= search_stamp);
+                        if (stamp == search_stamp &&
+                            (tile->search_closed ||
+                             tile->search_moves <= node.moves + 1))
+                                continue;
+
+                        /* Tile blocked? */
+                        if ((!G_tile_open(neighbors[i], ship) &&
+                             !ship_leaving_tile(neighbors[i])) ||
+                            tile_bridged(node.tile, i))
+                                continue;
+
+                        /* Outside the corridor? */
+                        if (corridor && nav_regions[tile->region].corridor !=
+                                        nav_corridor)
+                                continue;
+
+                        /* Open the node */
+                        tile->search_stamp = search_stamp;
+                        tile->search_parent = node.tile;
+                        tile->search_moves = node.moves + 1;
+                        tile->search_closed = FALSE;
+                        dist = tile_dist(neighbors[i], target) - bias;
+                        if (dist < 0.f)
+                                dist = 0.f;
+                        search_push(neighbors[i], node.moves + 1,
+                                    node.moves + 1 + dist);
+                }
+        }
+        return -1;
+}
+
+/******************************************************************************\
+ Finds a path for [ship] using the region graph to limit the search for long
+ paths. Unreachable targets fail without searching. Returns the last tile of
+ the path or -1 if the target cannot be reached.
+\******************************************************************************/
+static int path_find(int ship, int from, int target, bool target_next)
+{
+        int goal;
+
+        if (!G_tile_reachable(from, target, target_next))
+                return -1;
+
+        /* Other ships may block the corridor, so search everything if the
+           limited search fails */
+        if (plan_corridor(from, target) &&
+            (goal = path_search(ship, from, target, target_next,
+                                TRUE, 0)) >= 0)
+                return goal;
+        return path_search(ship, from, target, target_next, FALSE, 0);
+}
+
+/******************************************************************************\
+ Writes the first [len] moves of the path found by the last search to the
+ [goal] tile into [path]. Returns TRUE if the path changed.
+\******************************************************************************/
+static bool write_search_path(char *path, int goal, int len)
+{
+        int i, j, pos, parent, neighbors[3];
+        bool changed;
+
+        changed = FALSE;
+        pos = g_tiles[goal].search_moves;
+        for (i = goal; (parent = g_tiles[i].search_parent) >= 0; i = parent) {
+                if (--pos >= len)
+                        continue;
+                R_tile_neighbors(parent, neighbors);
+                for (j = 0; neighbors[j] != i; j++);
+                if (path[pos] != j + 1)
+                        changed = TRUE;
+                path[pos] = j + 1;
+        }
+        return changed;
+}
+
+/******************************************************************************\
+ Tries to reuse the [ship]'s current path to the [target]. If other ships
+ have moved onto the path, a short detour around them is searched for and
+ spliced into the path.
+\******************************************************************************/
+static path_reuse_t path_reuse(int ship, int target, bool target_next)
+{
+        int len, start, blocked, rejoin, goal, detour, end, tiles[R_PATH_MAX],
+            neighbors[3];
+        char *path;
+
+        /* Follow the old path and find the first blocked tile */
+        path = g_ships[ship].path;
+        tiles[0] = g_ships[ship].tile;
+        blocked = -1;
+        for (len = 0; path[len] > 0; len++) {
+                R_tile_neighbors(tiles[len], neighbors);
+                tiles[len + 1] = neighbors[path[len] - 1];
+                if (blocked < 0 && !G_tile_open(tiles[len + 1], ship) &&
+                    !ship_leaving_tile(tiles[len + 1]))
+                        blocked = len + 1;
+        }
+        if (len < 1)
+                return PATH_INVALID;
+
+        /* The path must still lead to the target. Paths that were cut short
+           are kept until half of them has been sailed. */
+        end = tiles[len];
+        if (end != target && len < R_PATH_MAX / 2) {
+                if (!target_next)
+                        return PATH_INVALID;
+                R_tile_neighbors(target, neighbors);
+                if (neighbors[0] != end && neighbors[1] != end &&
+                    neighbors[2] != end)
+                        return PATH_INVALID;
+        }
+        if (blocked < 0)
+                return PATH_KEPT;
+
+        /* Rejoin the path at the first open tile past the blocked ones */
+        for (rejoin = blocked + 1; ; rejoin++) {
+                if (rejoin > len || rejoin > blocked + REPAIR_WINDOW)
+                        return PATH_INVALID;
+                if (G_tile_open(tiles[rejoin], ship))
+                        break;
+        }
+
+        /* Search for a short detour */
+        start = blocked > REPAIR_WINDOW ? blocked - REPAIR_WINDOW : 0;
+        goal = path_search(ship, tiles[start], tiles[rejoin], FALSE, FALSE,
+                           REPAIR_SEARCH);
+        if (goal < 0)
+                return PATH_INVALID;
+        detour = g_tiles[goal].search_moves;
+        if (start + detour + len - rejoin > R_PATH_MAX - 1)
+                return PATH_INVALID;
+
+        /* Splice the detour in */
+        memmove(path + start + detour, path + rejoin, len - rejoin + 1);
+        write_search_path(path + start, goal, detour);
+        return PATH_REPAIRED;
+}
+
 /******************************************************************************\
  Find a path from where the [ship] is to the target [tile] and sets that as
- the ship's new path.
+ the ship's new path. Paths that are too long to store are cut short; the
+ ship will search for the rest of the way as it moves.
 \******************************************************************************/
 void G_ship_path(int ship, int target)
 {
-        static int search_stamp;
-        search_node_t nodes[SEARCH_BREADTH];
-        int i, nodes_len, closest, path_len, neighbors[3];
+        path_reuse_t reuse;
+        int i, goal, path_len, old_target;
         bool changed, target_next;
 
         if (n_client_id != N_HOST_CLIENT_ID)
                 return;
+        G_ship_wake(ship);
         changed = FALSE;
 
         /* Silent fail */
@@ -116,7 +696,7 @@ void G_ship_path(int ship, int target)
                 g_ships[ship].target = g_ships[ship].tile;
                 if (changed) {
                         g_ships[ship].path[0] = NUL;
-                        G_ship_send_path(ship, N_BROADCAST_ID);
+                        G_ship_broadcast_path(ship);
                         if (g_ships[ship].client == n_client_id &&
                             g_selected_ship == ship)
                                 R_select_path(-1, NULL);
@@ -125,125 +705,53 @@ void G_ship_path(int ship, int target)
         }
 
         /* Clear the target for now */
+        old_target = g_ships[ship].target;
         g_ships[ship].target = g_ships[ship].tile;
 
         /* If the target tile is not available, try to get next to it instead
            of onto it */
         target_next = !G_tile_open(target, ship);
 
-        /* Start with just the initial tile open */
-        search_stamp++;
-        nodes[0].tile = g_ships[ship].tile;
-        nodes[0].dist = tile_dist(nodes[0].tile, target);
-        nodes[0].moves = 0;
-        nodes_len = 1;
-        g_tiles[nodes[0].tile].search_parent = -1;
-        g_tiles[nodes[0].tile].search_stamp = search_stamp;
-        closest = 0;
-
-        for (;;) {
-                search_node_t node;
-
-                node = nodes[closest];
-
-                /* Ran out of search nodes -- no path to target */
-                if (nodes_len < 1)
-                        goto failed;
-
-                /* Remove the node from the list */
-                nodes_len--;
-                memmove(nodes + closest, nodes + closest + 1,
-                        (nodes_len - closest) * sizeof (*nodes));
-
-                /* Add its children */
-                R_tile_neighbors(node.tile, neighbors);
-                for (i = 0; i < 3; i++) {
-                        int stamp;
-                        bool open;
-
-                        /* Out of space? */
-                        if (nodes_len >= SEARCH_BREADTH) {
-                                C_warning("Out of search space");
-                                return;
-                        }
-
-                        /* Made it to an adjacent tile */
-                        if (target_next && neighbors[i] == target) {
-                                nodes[nodes_len] = node;
-                                goto rewind;
-                        }
-
-                        /* Tile blocked? */
-                        open = G_tile_open(neighbors[i], ship) ||
-                               ship_leaving_tile(neighbors[i]);
-
-                        /* Can we open this node? */
-                        stamp = g_tiles[neighbors[i]].search_stamp;
-                        C_assert(stamp <= search_stamp);
-                        if (stamp == search_stamp || !open ||
-                            R_land_bridge(node.tile, neighbors[i]))
-                                continue;
-                        g_tiles[neighbors[i]].search_stamp = search_stamp;
-
-                        /* Add to array */
-                        nodes[nodes_len].tile = neighbors[i];
-                        g_tiles[neighbors[i]].search_parent = node.tile;
-
-                        /* Did we make it onto the target? */
-                        if (neighbors[i] == target)
-                                goto rewind;
-
-                        /* Distance to destination */
-                        nodes[nodes_len].dist = tile_dist(neighbors[i], target);
-                        nodes[nodes_len].moves = node.moves + 1;
-
-                        nodes_len++;
-                }
-
-                /* Find the new closest node */
-                for (closest = 0, i = 1; i < nodes_len; i++)
-                        if (2 * nodes[i].moves + nodes[i].dist <
-                            2 * nodes[closest].moves + nodes[closest].dist)
-                                closest = i;
+        /* Keep or repair the old path if it still leads to the target */
+        reuse = PATH_INVALID;
+        if (old_target == target)
+                reuse = path_reuse(ship, target, target_next);
+        if (reuse == PATH_KEPT) {
+                C_count_add(&g_count_paths_kept, 1);
+                g_ships[ship].target = target;
+                return;
+        }
+        if (reuse == PATH_REPAIRED) {
+                C_count_add(&g_count_paths_repaired, 1);
+                changed = TRUE;
+                goto done;
         }
 
-rewind: /* Count length of the path */
-        path_len = -1;
-        for (i = nodes[nodes_len].tile; i >= 0; i = g_tiles[i].search_parent)
-                path_len++;
+        C_count_add(&g_count_paths_searched, 1);
+        goal = path_find(ship, g_ships[ship].tile, target, target_next);
+        if (goal < 0)
+                goto failed;
 
-        /* The path is too long */
-        if (path_len > R_PATH_MAX) {
-                C_warning("Path is too long (%d tiles)", path_len);
-                return;
-        }
+        /* Only store as much of the path as will fit */
+        path_len = g_tiles[goal].search_moves;
+        if (path_len > R_PATH_MAX - 1)
+                path_len = R_PATH_MAX - 1;
 
-        /* Write the path backwards */
+        /* Write the path */
         if (g_ships[ship].path[path_len])
                 changed = TRUE;
         g_ships[ship].path[path_len] = 0;
-        for (i = nodes[nodes_len].tile; i >= 0; ) {
-                int j, parent;
+        if (write_search_path(g_ships[ship].path, goal, path_len))
+                changed = TRUE;
 
-                parent = g_tiles[i].search_parent;
-                if (parent < 0)
-                        break;
-                R_tile_neighbors(parent, neighbors);
-                for (j = 0; neighbors[j] != i; j++);
-                path_len--;
-                if (g_ships[ship].path[path_len] != j + 1)
-                        changed = TRUE;
-                g_ships[ship].path[path_len] = j + 1;
-                i = parent;
-        }
-        g_ships[ship].target = target;
+done:   g_ships[ship].target = target;
 
         /* Update ship selection */
         if (changed) {
                 if (g_selected_ship == ship &&
                     g_ships[ship].client == n_client_id)
                         R_select_path(g_ships[ship].tile, g_ships[ship].path);
-                G_ship_send_path(ship, N_BROADCAST_ID);
+                G_ship_broadcast_path(ship);
         }
 
         return;
@@ -301,46 +809,69 @@ static float ship_speed(int index)
 }
 
 /******************************************************************************\
- Position and orient the ship's model.
+ Work out where the ship is as of this simulation tick. The model is placed
+ between this position and the last one when the ships are interpolated.
 \******************************************************************************/
-static void ship_position_model(int ship)
+static void ship_position(int ship)
 {
-        r_model_t *model;
+        g_ship_t *p;
         int new_tile, old_tile;
 
-        if (ship < 0 || ship >= G_SHIPS_MAX || !g_ships[ship].in_use)
+        if (ship < 0 || ship >= g_ships_max || !g_ships[ship].in_use)
                 return;
-        new_tile = g_ships[ship].tile;
-        old_tile = g_ships[ship].rear_tile;
-        model = &g_ships[ship].model;
+        p = g_ships + ship;
+        new_tile = p->tile;
+        old_tile = p->rear_tile;
+        p->last_normal = p->normal;
+        p->last_origin = p->origin;
 
         /* If the ship is not moving, just place it on the tile */
-        if (g_ships[ship].rear_tile < 0) {
-                model->normal = r_tiles[new_tile].normal;
-                model->origin = r_tiles[new_tile].origin;
+        if (p->rear_tile < 0) {
+                p->normal = r_tiles[new_tile].normal;
+                p->origin = r_tiles[new_tile].origin;
         }
 
         /* Otherwise interpolate normal and origin */
         else {
-                model->normal = C_vec3_lerp(r_tiles[old_tile].normal,
-                                            g_ships[ship].progress,
-                                            r_tiles[new_tile].normal);
-                model->normal = C_vec3_norm(model->normal);
-                model->origin = C_vec3_lerp(r_tiles[old_tile].origin,
-                                            g_ships[ship].progress,
-                                            r_tiles[new_tile].origin);
+                p->normal = C_vec3_lerp(r_tiles[old_tile].normal, p->progress,
+                                        r_tiles[new_tile].normal);
+                p->normal = C_vec3_norm(p->normal);
+                p->origin = C_vec3_lerp(r_tiles[old_tile].origin, p->progress,
+                                        r_tiles[new_tile].origin);
         }
+}
 
-        /* Rotate toward the forward vector */
-        if (!C_vec3_eq(model->forward, g_ships[ship].forward)) {
-                float lerp;
-
-                lerp = ROTATION_RATE * c_frame_sec * ship_speed(ship);
-                if (lerp > 1.f)
-                        lerp = 1.f;
+/******************************************************************************\
+ Position and orient every ship's model for the frame about to be rendered.
+ Ships only move on simulation ticks, so each model is placed [lerp] of the
+ way from where its ship was on the tick before the last one to where it was
+ on the last one. Models turn toward their ship's heading at frame rate.
+\******************************************************************************/
+void G_interpolate_ships(float lerp)
+{
+        r_model_t *model;
+        float rotate;
+        int i;
+
+        for (i = 0; i < g_ships_max; i++) {
+                if (!g_ships[i].in_use)
+                        continue;
+                model = &g_ships[i].model;
+                model->normal = C_vec3_lerp(g_ships[i].last_normal, lerp,
+                                            g_ships[i].normal);
+                model->normal = C_vec3_norm(model->normal);
+                model->origin = C_vec3_lerp(g_ships[i].last_origin, lerp,
+                                            g_ships[i].origin);
+
+                /* Rotate toward the forward vector */
+                if (C_vec3_eq(model->forward, g_ships[i].forward))
+                        continue;
+                rotate = ROTATION_RATE * c_frame_sec * ship_speed(i);
+                if (rotate > 1.f)
+                        rotate = 1.f;
                 model->forward = C_vec3_norm(model->forward);
                 model->forward = C_vec3_rotate_to(model->forward, model->normal,
-                                                  lerp, g_ships[ship].forward);
+                                                  rotate, g_ships[i].forward);
         }
 }
 
@@ -361,13 +892,19 @@ bool G_ship_move_to(int i, int new_tile)
         /* Remove this ship from the old tile */
         C_assert(g_ships[i].rear_tile != g_ships[i].tile);
         if (g_ships[i].rear_tile >= 0 &&
-            g_tiles[g_ships[i].rear_tile].ship == i)
+            g_tiles[g_ships[i].rear_tile].ship == i) {
                 g_tiles[g_ships[i].rear_tile].ship = -1;
+                G_ship_wake_tile(g_ships[i].rear_tile);
+        }
 
-        /* Move to the new tile */
+        /* Move to the new tile. Ships around the tile this ship was stopped on
+           can no longer trade with it. */
+        if (g_ships[i].rear_tile < 0)
+                G_ship_wake_tile(old_tile);
         g_ships[i].rear_tile = old_tile;
         g_ships[i].tile = new_tile;
         g_tiles[new_tile].ship = i;
+        G_ship_wake_tile(new_tile);
 
         /* Make a new path to our target */
         G_ship_path(i, g_ships[i].target);
@@ -423,8 +960,10 @@ static void ship_move(int i)
         /* Remove this ship from the old tile */
         C_assert(g_ships[i].rear_tile != g_ships[i].tile);
         if (g_ships[i].rear_tile >= 0 &&
-            g_tiles[g_ships[i].rear_tile].ship == i)
+            g_tiles[g_ships[i].rear_tile].ship == i) {
                 g_tiles[g_ships[i].rear_tile].ship = -1;
+                G_ship_wake_tile(g_ships[i].rear_tile);
+        }
 
         /* See if we hit an obstacle */
         if (!arrived) {
@@ -440,6 +979,7 @@ static void ship_move(int i)
         if (arrived || !open) {
                 g_ships[i].path[0] = 0;
                 g_ships[i].rear_tile = -1;
+                G_ship_wake_tile(g_ships[i].tile);
                 return;
         }
 
@@ -454,22 +994,68 @@ static void ship_move(int i)
         forward = C_vec3_norm(C_vec3_sub(r_tiles[new_tile].origin,
                                          r_tiles[old_tile].origin));
 
+        /* Ships around the tile this ship was stopped on can no longer trade
+           with it */
+        if (g_ships[i].rear_tile < 0)
+                G_ship_wake_tile(old_tile);
+
         g_ships[i].progress = g_ships[i].progress - 1.f;
         g_ships[i].rear_tile = old_tile;
         g_ships[i].tile = new_tile;
         g_ships[i].forward = forward;
         g_tiles[new_tile].ship = i;
+        G_ship_wake_tile(new_tile);
 
         /* Pick up crate gibs */
         G_ship_collect_gib(i);
 }
 
 /******************************************************************************\
- Update a ship's movement.
+ Update a ship's movement. Ships stop once the game is over.
 \******************************************************************************/
 void G_ship_update_move(int i)
 {
-        ship_move(i);
-        ship_position_model(i);
+        if (!g_game_over)
+                ship_move(i);
+        ship_position(i);
 }
 
+
+/******************************************************************************\
+ Times random path searches on every globe size when [g_test_paths] is set.
+ Regenerates the globe, so this must be called before the game globe is
+ initialized.
+\******************************************************************************/
+void G_test_paths(void)
+{
+        int i, subdiv4, queries, found, *tiles;
+        unsigned int msec;
+
+        C_var_unlatch(&g_test_paths);
+        if ((queries = g_test_paths.value.n) < 1)
+                return;
+        C_status("Timing %d path searches per globe size", queries);
+        tiles = C_malloc(2 * queries * sizeof (*tiles));
+        for (subdiv4 = 3; subdiv4 <= R_SUBDIV4_MAX; subdiv4++) {
+                G_generate_globe(subdiv4, 0, 0, -1.f);
+
+                /* Pick the endpoints before starting the timer */
+                for (i = 0; i < 2 * queries; i++)
+                        if ((tiles[i] = G_random_open_tile()) < 0)
+                                goto cleanup;
+
+                C_timer();
+                search_expanded = 0;
+                for (found = i = 0; i < queries; i++)
+                        if (path_find(-1, tiles[2 * i], tiles[2 * i + 1],
+                                      FALSE) >= 0)
+                                found++;
+                msec = C_timer();
+                C_debug("%d tiles: %d/%d paths found in %d msec, "
+                        "%.1f tiles expanded per search", r_tiles_max, found,
+                        queries, msec, (float)search_expanded / queries);
+        }
+
+cleanup:
+        C_free(tiles);
+}
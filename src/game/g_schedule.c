@@ -0,0 +1,260 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* Keeps track of which ships need updating. Most ships sit still for most of
+   the game, so only awake ships are updated each tick. A ship stays awake
+   while it is moving, following, fighting or settling into place and is woken
+   again when anything around it changes. Timed events wake a sleeping ship
+   from a heap of timers. */
+
+#include "g_common.h"
+
+/* Timers per ship the timer heap has room for. Timers that have been replaced
+   are left in the heap until they come up. */
+#define TIMERS_PER_SHIP 4
+
+/* Ships to update this tick, in the order they were woken */
+int *g_awake_ships, g_awake_len;
+
+/* Heap of timers ordered by time */
+typedef struct wake_timer {
+        int time, ship;
+} wake_timer_t;
+
+static wake_timer_t *timers;
+static int timers_len, timers_max, *timer_times;
+static bool *awake, *timer_set, game_over;
+
+/******************************************************************************\
+ Forget all awake ships and timers.
+\******************************************************************************/
+void G_reset_schedule(void)
+{
+        if (g_ships_max > 0) {
+                memset(awake, 0, g_ships_max * sizeof (*awake));
+                memset(timer_set, 0, g_ships_max * sizeof (*timer_set));
+        }
+        g_awake_len = 0;
+        timers_len = 0;
+        game_over = g_game_over;
+}
+
+/******************************************************************************\
+ Size the schedule for [ships] ships. Pass zero to free it.
+\******************************************************************************/
+void G_resize_schedule(int ships)
+{
+        C_free(g_awake_ships);
+        C_free(timers);
+        C_free(timer_times);
+        C_free(awake);
+        C_free(timer_set);
+        g_awake_ships = timer_times = NULL;
+        timers = NULL;
+        awake = timer_set = NULL;
+        timers_max = 0;
+        if (ships > 0) {
+                g_awake_ships = C_calloc(ships * sizeof (*g_awake_ships));
+                timer_times = C_calloc(ships * sizeof (*timer_times));
+                awake = C_calloc(ships * sizeof (*awake));
+                timer_set = C_calloc(ships * sizeof (*timer_set));
+                timers_max = ships * TIMERS_PER_SHIP;
+                timers = C_calloc(timers_max * sizeof (*timers));
+        }
+        G_reset_schedule();
+}
+
+/******************************************************************************\
+ Wake a ship so that it is updated this tick, or next tick if this tick's
+ updates are already done with it.
+\******************************************************************************/
+void G_ship_wake(int ship)
+{
+        if (ship < 0 || ship >= g_ships_max || awake[ship] ||
+            !g_ships[ship].in_use)
+                return;
+        awake[ship] = TRUE;
+        g_awake_ships[g_awake_len++] = ship;
+}
+
+/******************************************************************************\
+ Wake a ship and have it recompute who can see its store.
+\******************************************************************************/
+static void wake_visible(int ship)
+{
+        if (ship < 0 || ship >= g_ships_max || !g_ships[ship].in_use)
+                return;
+        g_ships[ship].visible_stale = TRUE;
+        G_ship_wake(ship);
+}
+
+/******************************************************************************\
+ Wake the ship on [tile] and the ships on its neighbors. Something changed
+ around the tile, so their stores' visibility is recomputed as well.
+\******************************************************************************/
+void G_ship_wake_tile(int tile)
+{
+        int i, neighbors[3];
+
+        if (tile < 0 || tile >= r_tiles_max)
+                return;
+        wake_visible(g_tiles[tile].ship);
+        R_tile_neighbors(tile, neighbors);
+        for (i = 0; i < 3; i++)
+                wake_visible(g_tiles[neighbors[i]].ship);
+}
+
+/******************************************************************************\
+ Wake a ship and the ships around it.
+\******************************************************************************/
+void G_ship_wake_around(int ship)
+{
+        if (ship < 0 || ship >= g_ships_max || !g_ships[ship].in_use)
+                return;
+        G_ship_wake_tile(g_ships[ship].tile);
+        G_ship_wake_tile(g_ships[ship].rear_tile);
+}
+
+/******************************************************************************\
+ Move the timer at [i] up or down the heap until it is in order.
+\******************************************************************************/
+static void timer_sift_up(int i)
+{
+        wake_timer_t timer;
+        int parent;
+
+        timer = timers[i];
+        for (; i > 0; i = parent) {
+                parent = (i - 1) / 2;
+                if (timers[parent].time <= timer.time)
+                        break;
+                timers[i] = timers[parent];
+        }
+        timers[i] = timer;
+}
+
+static void timer_sift_down(int i)
+{
+        wake_timer_t timer;
+        int child;
+
+        timer = timers[i];
+        for (; (child = 2 * i + 1) < timers_len; i = child) {
+                if (child + 1 < timers_len &&
+                    timers[child + 1].time < timers[child].time)
+                        child++;
+                if (timer.time <= timers[child].time)
+                        break;
+                timers[i] = timers[child];
+        }
+        timers[i] = timer;
+}
+
+/******************************************************************************\
+ Returns TRUE if the timer is the ship's current one.
+\******************************************************************************/
+static bool timer_current(const wake_timer_t *timer)
+{
+        return timer_set[timer->ship] &&
+               timer_times[timer->ship] == timer->time;
+}
+
+/******************************************************************************\
+ Throw out the timers that have been replaced and rebuild the heap.
+\******************************************************************************/
+static void timers_compact(void)
+{
+        int i, len;
+
+        for (len = i = 0; i < timers_len; i++)
+                if (timer_current(timers + i))
+                        timers[len++] = timers[i];
+        timers_len = len;
+        for (i = timers_len / 2 - 1; i >= 0; i--)
+                timer_sift_down(i);
+}
+
+/******************************************************************************\
+ Wake a ship at [time]. Each ship has one timer and setting it again replaces
+ the old one.
+\******************************************************************************/
+void G_ship_wake_at(int ship, int time)
+{
+        if (ship < 0 || ship >= g_ships_max ||
+            (timer_set[ship] && timer_times[ship] == time))
+                return;
+        timer_set[ship] = TRUE;
+        timer_times[ship] = time;
+        if (timers_len >= timers_max)
+                timers_compact();
+        C_assert(timers_len < timers_max);
+        timers[timers_len].time = time;
+        timers[timers_len].ship = ship;
+        timer_sift_up(timers_len++);
+}
+
+/******************************************************************************\
+ Wake ships whose timers have come up. Every ship is woken when the game ends
+ or restarts.
+\******************************************************************************/
+void G_wake_ships(void)
+{
+        wake_timer_t timer;
+        int i;
+
+        if (game_over != g_game_over) {
+                game_over = g_game_over;
+                for (i = 0; i < g_ships_max; i++)
+                        wake_visible(i);
+        }
+        while (timers_len > 0 && timers[0].time <= c_time_msec) {
+                timer = timers[0];
+                timers[0] = timers[--timers_len];
+                timer_sift_down(0);
+                if (!timer_current(&timer))
+                        continue;
+                timer_set[timer.ship] = FALSE;
+                G_ship_wake(timer.ship);
+        }
+}
+
+/******************************************************************************\
+ Returns TRUE if the ship will have something to do next tick.
+\******************************************************************************/
+static bool ship_busy(int ship)
+{
+        const g_ship_t *p;
+
+        p = g_ships + ship;
+        return p->in_use &&
+               (p->path[0] > 0 || p->rear_tile >= 0 || p->target_ship >= 0 ||
+                p->boarding > 0 || p->boarding_ship >= 0 ||
+                !C_vec3_eq(p->origin, p->last_origin) ||
+                !C_vec3_eq(p->normal, p->last_normal));
+}
+
+/******************************************************************************\
+ Put the ships that have nothing left to do to sleep.
+\******************************************************************************/
+void G_sleep_ships(void)
+{
+        int i, len, ship;
+
+        for (len = i = 0; i < g_awake_len; i++) {
+                ship = g_awake_ships[i];
+                if (ship_busy(ship))
+                        g_awake_ships[len++] = ship;
+                else
+                        awake[ship] = FALSE;
+        }
+        g_awake_len = len;
+}
@@ -45,6 +45,7 @@ void G_cleanup(void);
 void G_init(void);
 void G_refresh_servers(void);
 void G_update_client(void);
+void G_update_tick(void);
 
 /* g_commands.c */
 void G_buy_cargo(g_cargo_type_t, int amount);
@@ -74,9 +75,13 @@ void G_host_game(void);
 void G_update_host(void);
 
 extern int g_clients_max, g_time_limit_msec;
+extern bool g_headless;
+
+/* g_movement.c */
+void G_interpolate_ships(float lerp);
 
 /* g_variables.c */
 void G_register_variables(void);
 
-extern c_var_t g_draw_distance;
+extern c_var_t g_draw_distance, g_tick_rate;
 
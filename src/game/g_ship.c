@@ -20,8 +20,9 @@
 /* Maximum crew value */
 #define CREW_MAX (G_SHIP_OPTIMAL_CREW * 400)
 
-/* Ships array */
-g_ship_t g_ships[G_SHIPS_MAX];
+/* Ships array, sized for the game being played */
+g_ship_t *g_ships;
+int g_ships_max;
 
 /* The ship the mouse is hovering over and the currently selected ship */
 int g_hover_ship, g_selected_ship;
@@ -44,8 +45,27 @@ void G_cleanup_ships(void)
 {
         int i;
 
-        for (i = 0; i < G_SHIPS_MAX; i++)
+        for (i = 0; i < g_ships_max; i++)
                 ship_cleanup(i);
+        G_reset_schedule();
+}
+
+/******************************************************************************\
+ Cleanup all ships and size the ship tables for a game of up to [ships] ships.
+ Pass zero to free the tables.
+\******************************************************************************/
+void G_resize_ships(int ships)
+{
+        G_cleanup_ships();
+        C_free(g_ships);
+        g_ships = NULL;
+        if (ships > G_SHIPS_LIMIT)
+                ships = G_SHIPS_LIMIT;
+        if ((g_ships_max = ships) > 0)
+                g_ships = C_calloc(ships * sizeof (*g_ships));
+        G_resize_schedule(ships);
+        G_resize_interest(ships);
+        G_resize_snapshot(ships);
 }
 
 /******************************************************************************\
@@ -55,8 +75,9 @@ void G_ship_send_spawn(int index, n_client_id_t client)
 {
         if (!g_ships[index].in_use)
                 return;
-        N_send(client, "11121", G_SM_SHIP_SPAWN, index,
+        N_send(client, "12121", G_SM_SHIP_SPAWN, index,
                g_ships[index].client, g_ships[index].tile, g_ships[index].type);
+        G_snapshot_reset(index, client);
 }
 
 /******************************************************************************\
@@ -66,7 +87,7 @@ void G_ship_send_name(int index, n_client_id_t client)
 {
         if (!g_ships[index].in_use)
                 return;
-        N_send(client, "11s", G_SM_SHIP_NAME, index, g_ships[index].name);
+        N_send(client, "12s", G_SM_SHIP_NAME, index, g_ships[index].name);
 }
 
 /******************************************************************************\
@@ -85,20 +106,22 @@ int G_ship_spawn(int index, n_client_id_t client, int tile, g_ship_type_t type)
                           index, client, tile, type);
                 return -1;
         }
-        if (index >= G_SHIPS_MAX) {
+        if (index >= g_ships_max) {
                 C_warning("Failed to spawn ship at tile %d, "
                           "index out of range (%d)", tile, index);
                 return -1;
         }
 
         /* Find an available ship slot if [index] is not given */
-        if (index < 0)
-                for (index = 0; g_ships[index].in_use; index++)
-                        if (index >= G_SHIPS_MAX) {
-                                C_warning("Failed to spawn ship at tile %d, "
-                                          "array full", tile);
-                                return -1;
-                        }
+        if (index < 0) {
+                for (index = 0; index < g_ships_max &&
+                     g_ships[index].in_use; index++);
+                if (index == g_ships_max) {
+                        C_warning("Failed to spawn ship at tile %d, "
+                                  "array full", tile);
+                        return -1;
+                }
+        }
 
         /* If we are to spawn the ship anywhere, pick a random tile */
         if (tile < 0)
@@ -141,10 +164,14 @@ int G_ship_spawn(int index, n_client_id_t client, int tile, g_ship_type_t type)
         /* Place the ship on the tile */
         R_model_init(&ship->model, g_ship_classes[type].model_path, TRUE);
         G_tile_position_model(tile, &ship->model);
+        ship->normal = ship->last_normal = ship->model.normal;
+        ship->origin = ship->last_origin = ship->model.origin;
         g_tiles[tile].ship = index;
+        G_ship_wake_tile(tile);
 
         /* Initialize store */
         G_store_init(&ship->store, g_ship_classes[ship->type].cargo);
+        ship->store.ship = index;
 
         /* If we are the server, tell other clients */
         if (n_client_id == N_HOST_CLIENT_ID)
@@ -153,7 +180,7 @@ int G_ship_spawn(int index, n_client_id_t client, int tile, g_ship_type_t type)
         /* If this is one of ours, name it */
         if (client == n_client_id) {
                 G_get_name_buf(G_NT_SHIP, ship->name);
-                N_send(N_SERVER_ID, "11s", G_CM_SHIP_NAME, index, ship->name);
+                N_send(N_SERVER_ID, "12s", G_CM_SHIP_NAME, index, ship->name);
         }
 
         /* If we spawned on a gib, collect it */
@@ -176,7 +203,7 @@ void G_render_ships(void)
 
         if (i_limbo)
                 return;
-        for (i = 0; i < G_SHIPS_MAX; i++) {
+        for (i = 0; i < g_ships_max; i++) {
                 ship = g_ships + i;
                 if (!ship->in_use)
                         continue;
@@ -222,7 +249,7 @@ static void ship_configure_trade(int index)
         /* Our client can't actually see this cargo -- we probably don't have
            the right data for it anyway! */
         ship = g_ships + index;
-        if (index < 0 || !ship->store.visible[n_client_id]) {
+        if (index < 0 || !G_store_visible(&ship->store, n_client_id)) {
                 I_disable_trade();
                 return;
         }
@@ -283,7 +310,7 @@ static void ship_configure_trade(int index)
 \******************************************************************************/
 static bool ship_can_trade(int index)
 {
-        return index >= 0 && index < G_SHIPS_MAX &&
+        return index >= 0 && index < g_ships_max &&
                g_ships[index].in_use && g_ships[index].rear_tile < 0 &&
                g_ships[index].health > 0;
 }
@@ -350,123 +377,46 @@ static void ship_update_trade(int index)
 }
 
 /******************************************************************************\
- Send updated cargo information to clients. If [client] is negative, all
- clients that can see the ship's cargo are updated and only modified cargo
- entries are communicated.
-\******************************************************************************/
-void G_ship_send_cargo(int index, n_client_id_t client)
-{
-        int i;
-        bool broadcast;
-
-        /* Host already knows everything */
-        if (client == N_HOST_CLIENT_ID || n_client_id != N_HOST_CLIENT_ID)
-                return;
-
-        /* If crew changed, send the new value via status update */
-        if (g_ships[index].store.modified & (1 << G_CT_CREW)) {
-                g_ships[index].store.modified &= ~(1 << G_CT_CREW);
-                g_ships[index].modified = TRUE;
-        }
-
-        /* Nothing is sent if broadcasting an unmodified store */
-        if ((broadcast = client < 0 || client == N_BROADCAST_ID) &&
-            !g_ships[index].modified)
-                return;
-
-        /* Pack all the cargo information */
-        N_send_start();
-        N_send_char(G_SM_SHIP_CARGO);
-        N_send_char(index);
-        G_store_send(&g_ships[index].store,
-                     !broadcast || client == N_SELECTED_ID);
-
-        /* Already selected the target clients */
-        if (client == N_SELECTED_ID) {
-                N_send_selected(NULL);
-                return;
-        }
-
-        /* Send to clients that can see complete cargo information */
-        if (broadcast) {
-                for (i = 0; i < N_CLIENTS_MAX; i++)
-                        n_clients[i].selected = g_ships[index].store.visible[i];
-                N_send_selected(NULL);
-                return;
-        }
-
-        /* Send to a single client */
-        if (g_ships[index].store.visible[client])
-                N_send(client, NULL);
-}
-
-/******************************************************************************\
- Sends out the ship's current state.
-\******************************************************************************/
-void G_ship_send_state(int ship, n_client_id_t client)
-{
-        if (n_client_id != N_HOST_CLIENT_ID)
-                return;
-        N_broadcast_except(N_HOST_CLIENT_ID, "111211", G_SM_SHIP_STATE,
-                           ship, g_ships[ship].health,
-                           g_ships[ship].store.cargo[G_CT_CREW].amount,
-                           g_ships[ship].boarding, g_ships[ship].boarding_ship);
-}
-
-/******************************************************************************\
- Update which clients can see [ship]'s cargo. Also updates the ship's
- neighbors' visibility due to the [ship] having moved into its tile.
+ Update which clients can see [ship]'s cargo. Only done when a ship on or
+ around the ship's tile has moved, stopped or changed hands.
 \******************************************************************************/
 static void ship_update_visible(int ship)
 {
-        int i, client, neighbors[3];
-        bool old_visible[N_CLIENTS_MAX], selected;
-
-        memcpy(old_visible, g_ships[ship].store.visible, sizeof (old_visible));
-        C_zero_buf(g_ships[ship].store.visible);
-
-        /* We can always see the stores of our own ships */
-        client = g_ships[ship].client;
-        if (client >= 0 && client < N_CLIENTS_MAX)
-                g_ships[ship].store.visible[client] = TRUE;
+        unsigned int old_visible, visible;
+        int i, neighbor, neighbors[3];
 
-        /* Stopped neighboring ships' clients can see our store */
-        R_tile_neighbors(g_ships[ship].tile, neighbors);
-        for (i = 0; i < 3; i++) {
-                if (g_tiles[neighbors[i]].ship < 0 ||
-                    g_ships[g_tiles[neighbors[i]].ship].rear_tile >= 0)
-                        continue;
-                client = g_ships[g_tiles[neighbors[i]].ship].client;
-                if (client >= 0 && client < N_CLIENTS_MAX)
-                        g_ships[ship].store.visible[client] = TRUE;
-        }
+        if (!g_ships[ship].visible_stale)
+                return;
+        g_ships[ship].visible_stale = FALSE;
+        old_visible = g_ships[ship].store.visible;
 
         /* If the game is over, all ships are visible */
         if (g_game_over)
-                C_one_buf(g_ships[ship].store.visible);
+                visible = ~0u;
+
+        /* We can always see the stores of our own ships and stopped
+           neighboring ships' clients can see our store */
+        else {
+                visible = G_client_bit(g_ships[ship].client);
+                R_tile_neighbors(g_ships[ship].tile, neighbors);
+                for (i = 0; i < 3; i++) {
+                        neighbor = g_tiles[neighbors[i]].ship;
+                        if (neighbor >= 0 && g_ships[neighbor].rear_tile < 0)
+                                visible |= G_client_bit(g_ships[neighbor].
+                                                        client);
+                }
+        }
+        g_ships[ship].store.visible = visible;
 
         /* Reselect if our client's visibility toward this ship changed and
            we have it selected */
-        if (old_visible[n_client_id] !=
-            g_ships[ship].store.visible[n_client_id])
+        if ((old_visible ^ visible) & G_client_bit(n_client_id))
                 G_ship_reselect(ship, -1);
 
-        /* No need to send updates here if we aren't hosting */
-        if (n_client_id != N_HOST_CLIENT_ID)
-                return;
-
-        /* Only send the update to clients that can see the store now but
-           couldn't see it before */
-        for (selected = FALSE, i = 0; i < N_CLIENTS_MAX; i++) {
-                n_clients[i].selected = FALSE;
-                if (i == N_HOST_CLIENT_ID || old_visible[i] ||
-                    !g_ships[ship].store.visible[i])
-                        continue;
-                n_clients[i].selected = TRUE;
-                selected = TRUE;
-        }
-        if (selected)
-                G_ship_send_cargo(ship, N_SELECTED_ID);
+        /* Clients that can see the store now but couldn't see it before
+           need the cargo they missed */
+        if (n_client_id == N_HOST_CLIENT_ID && (visible & ~old_visible))
+                G_snapshot_modified(ship);
 }
 
 /******************************************************************************\
@@ -481,10 +431,12 @@ static void ship_update_food(int ship)
                 return;
 
         /* Not time to eat yet */
-        if (c_time_msec < g_ships[ship].lunch_time ||
-            g_ships[ship].store.cargo[G_CT_CREW].amount <= 0)
+        if ((crew = g_ships[ship].store.cargo[G_CT_CREW].amount) <= 0)
                 return;
-        crew = g_ships[ship].store.cargo[G_CT_CREW].amount;
+        if (c_time_msec < g_ships[ship].lunch_time) {
+                G_ship_wake_at(ship, g_ships[ship].lunch_time);
+                return;
+        }
 
         /* Consume rations first */
         if (g_ships[ship].store.cargo[G_CT_RATIONS].amount > 0) {
@@ -499,6 +451,7 @@ static void ship_update_food(int ship)
         }
 
         g_ships[ship].lunch_time = c_time_msec + available / crew;
+        G_ship_wake_at(ship, g_ships[ship].lunch_time);
 
         /* Did the crew just starve to death? */
         if (g_ships[ship].store.cargo[G_CT_CREW].amount <= 0)
@@ -506,31 +459,29 @@ static void ship_update_food(int ship)
 }
 
 /******************************************************************************\
- Updates ship positions and actions.
+ Updates ship positions and actions. Only ships that are awake are updated.
+ Ships woken by an update are appended to the awake list and are updated
+ this tick as well.
 \******************************************************************************/
 void G_update_ships(void)
 {
-        int i;
+        int i, ship;
 
-        for (i = 0; i < G_SHIPS_MAX; i++) {
-                if (!g_ships[i].in_use)
-                        continue;
+        G_wake_ships();
+        for (i = 0; i < g_awake_len; i++) {
+                ship = g_awake_ships[i];
+                G_ship_update_move(ship);
                 if (!g_game_over) {
-                        G_ship_update_move(i);
-                        G_ship_update_combat(i);
-                        ship_update_trade(i);
-                        ship_update_food(i);
+                        G_ship_update_combat(ship);
+                        ship_update_trade(ship);
+                        ship_update_food(ship);
                 }
-                ship_update_visible(i);
-
-                /* If the cargo manfiest changed, send updates once per frame */
-                if (g_ships[i].store.modified)
-                        G_ship_send_cargo(i, -1);
-
-                /* If the ship state changed, send an update */
-                if (g_ships[i].modified)
-                        G_ship_send_state(i, -1);
+                ship_update_visible(ship);
         }
+        G_sleep_ships();
+
+        /* Send clients what changed */
+        G_snapshot_send(G_update_interest());
 }
 
 /******************************************************************************\
@@ -613,7 +564,7 @@ static void ship_quick_info(int index)
                 return;
 
         /* Food supply before resorting to cannibalism */
-        if (!g_ships[index].store.visible[n_client_id])
+        if (!G_store_visible(&g_ships[index].store, n_client_id))
                 return;
         for (total = i = 0; i < G_CARGO_TYPES; i++) {
                 if (i == G_CT_CREW)
@@ -696,7 +647,7 @@ void G_ship_reselect(int index, n_client_id_t client)
 \******************************************************************************/
 bool G_ship_controlled_by(int index, n_client_id_t client)
 {
-        return index >= 0 && index < G_SHIPS_MAX && g_ships[index].in_use &&
+        return index >= 0 && index < g_ships_max && g_ships[index].in_use &&
                g_ships[index].health > 0 && g_ships[index].client == client;
 }
 
@@ -707,7 +658,7 @@ bool G_ship_hostile(int index, n_client_id_t to_client)
 {
         n_client_id_t ship_client;
 
-        if (index < 0 || index >= G_SHIPS_MAX || !g_ships[index].in_use ||
+        if (index < 0 || index >= g_ships_max || !g_ships[index].in_use ||
             g_ships[index].client == to_client)
                 return FALSE;
         ship_client = g_ships[index].client;
@@ -736,7 +687,7 @@ void G_focus_next_ship(void)
         available = 0;
         best_i = -1;
         best_dist = C_FLOAT_MAX;
-        for (i = 0; i < G_SHIPS_MAX; i++) {
+        for (i = 0; i < g_ships_max; i++) {
                 c_vec3_t origin;
                 float dist;
 
@@ -765,7 +716,7 @@ void G_focus_next_ship(void)
 \******************************************************************************/
 void G_ship_change_client(int ship, n_client_id_t client)
 {
-        N_broadcast("111", G_SM_SHIP_OWNER, ship, client);
+        N_broadcast("121", G_SM_SHIP_OWNER, ship, client);
 }
 
 /******************************************************************************\
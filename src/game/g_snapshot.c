@@ -0,0 +1,309 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* Collects changed ship state once per host update and sends each client a
+   single message containing only the fields that differ from what that client
+   was last sent */
+
+#include "g_common.h"
+
+/* Upper bound on the number of bytes one ship can add to a snapshot message.
+   Every value is a varint of at most five bytes. */
+#define SHIP_BYTES_MAX (5 * (3 + G_SF_CARGO + \
+                             G_CARGO_TYPES * (1 + G_CARGO_FIELDS)))
+
+/* Ship fields as they are encoded in a snapshot */
+typedef struct snapshot_ship {
+        int fields[G_SF_CARGO], cargo[G_CARGO_TYPES][G_CARGO_FIELDS];
+} snapshot_ship_t;
+
+/* What each connected client was last sent about each ship */
+static snapshot_ship_t *baselines[N_CLIENTS_MAX];
+
+/* Ship fields as of the last update they were encoded in, the ships that
+   changed during the current update and which ships are on that list */
+static snapshot_ship_t *current;
+static int *dirty, dirty_len;
+static bool *queued;
+
+/* Clients that missed an update and need every ship compared */
+static bool resync[N_CLIENTS_MAX];
+
+/******************************************************************************\
+ Allocate a client's baselines when it joins. The ships it is sent fill them
+ in.
+\******************************************************************************/
+void G_snapshot_init_client(n_client_id_t client)
+{
+        if (n_client_id != N_HOST_CLIENT_ID || client < 0 ||
+            client >= N_CLIENTS_MAX || baselines[client] || g_ships_max < 1)
+                return;
+        baselines[client] = C_calloc(g_ships_max * sizeof (*baselines[0]));
+}
+
+/******************************************************************************\
+ Free a client's baselines when it disconnects.
+\******************************************************************************/
+void G_snapshot_cleanup_client(n_client_id_t client)
+{
+        if (client < 0 || client >= N_CLIENTS_MAX)
+                return;
+        C_free(baselines[client]);
+        baselines[client] = NULL;
+}
+
+/******************************************************************************\
+ Size the snapshot tables for [ships] ships. Pass zero to free them. Client
+ baselines are thrown out and allocated again as clients are reinitialized.
+\******************************************************************************/
+void G_resize_snapshot(int ships)
+{
+        int i;
+
+        C_free(current);
+        C_free(dirty);
+        C_free(queued);
+        current = NULL;
+        dirty = NULL;
+        queued = NULL;
+        dirty_len = 0;
+        if (ships > 0) {
+                current = C_calloc(ships * sizeof (*current));
+                dirty = C_calloc(ships * sizeof (*dirty));
+                queued = C_calloc(ships * sizeof (*queued));
+        }
+        for (i = 0; i < N_CLIENTS_MAX; i++)
+                G_snapshot_cleanup_client(i);
+}
+
+/******************************************************************************\
+ Called when the state or cargo of [ship] changes on the host. The ship is
+ encoded and compared against client baselines in the next snapshot.
+\******************************************************************************/
+void G_snapshot_modified(int ship)
+{
+        if (n_client_id != N_HOST_CLIENT_ID || !queued || ship < 0 ||
+            ship >= g_ships_max || queued[ship])
+                return;
+        queued[ship] = TRUE;
+        dirty[dirty_len++] = ship;
+}
+
+/******************************************************************************\
+ Encode a store's cargo entries. Crew is sent as part of the ship's state.
+\******************************************************************************/
+static void snapshot_store(const g_store_t *store, snapshot_ship_t *out)
+{
+        const g_cargo_t *cargo;
+        int i;
+
+        for (i = 0; i < G_CARGO_TYPES; i++) {
+                cargo = store->cargo + i;
+                out->cargo[i][G_CF_AMOUNT] = i == G_CT_CREW ? 0 : cargo->amount;
+                out->cargo[i][G_CF_BUY_PRICE] = cargo->auto_buy ?
+                                                cargo->buy_price : -1;
+                out->cargo[i][G_CF_SELL_PRICE] = cargo->auto_sell ?
+                                                 cargo->sell_price : -1;
+                out->cargo[i][G_CF_MINIMUM] = cargo->minimum;
+                out->cargo[i][G_CF_MAXIMUM] = cargo->maximum;
+        }
+}
+
+/******************************************************************************\
+ Encode a ship's current state.
+\******************************************************************************/
+static void snapshot_ship(int ship, snapshot_ship_t *out)
+{
+        out->fields[G_SF_HEALTH] = g_ships[ship].health;
+        out->fields[G_SF_CREW] = g_ships[ship].store.cargo[G_CT_CREW].amount;
+        out->fields[G_SF_BOARDING] = g_ships[ship].boarding;
+        out->fields[G_SF_BOARDING_SHIP] = g_ships[ship].boarding_ship;
+        snapshot_store(&g_ships[ship].store, out);
+}
+
+/******************************************************************************\
+ Called when [client] is sent a ship spawn message. The client starts the ship
+ out in its spawn state, so that becomes the baseline changes are sent
+ against.
+\******************************************************************************/
+void G_snapshot_reset(int ship, n_client_id_t client)
+{
+        snapshot_ship_t spawned;
+        g_store_t store;
+        int i;
+
+        if (n_client_id != N_HOST_CLIENT_ID)
+                return;
+        C_zero(&spawned);
+        spawned.fields[G_SF_HEALTH] = g_ship_classes[g_ships[ship].type].health;
+        spawned.fields[G_SF_BOARDING_SHIP] = -1;
+        G_store_init(&store, g_ship_classes[g_ships[ship].type].cargo);
+        snapshot_store(&store, &spawned);
+
+        /* A single client needs the difference sent even if the ship did not
+           change this update */
+        if (client >= 0 && client < N_CLIENTS_MAX) {
+                if (baselines[client]) {
+                        baselines[client][ship] = spawned;
+                        resync[client] = TRUE;
+                }
+                return;
+        }
+        for (i = 0; i < N_CLIENTS_MAX; i++)
+                if (baselines[i])
+                        baselines[i][ship] = spawned;
+        G_snapshot_modified(ship);
+}
+
+/******************************************************************************\
+ Pack the fields of [ship] that differ from what [client] has. Returns FALSE
+ if nothing has changed.
+\******************************************************************************/
+static bool send_ship(n_client_id_t client, int ship)
+{
+        snapshot_ship_t *base, *now;
+        int i, j, mask, cargo_mask, field_masks[G_CARGO_TYPES];
+
+        base = baselines[client] + ship;
+        now = current + ship;
+
+        /* State is visible to everyone */
+        for (mask = i = 0; i < G_SF_CARGO; i++)
+                if (now->fields[i] != base->fields[i])
+                        mask |= 1 << i;
+
+        /* Cargo is only sent to clients that can see it */
+        cargo_mask = 0;
+        if (G_store_visible(&g_ships[ship].store, client))
+                for (i = 0; i < G_CARGO_TYPES; i++) {
+                        field_masks[i] = 0;
+                        for (j = 0; j < G_CARGO_FIELDS; j++)
+                                if (now->cargo[i][j] != base->cargo[i][j])
+                                        field_masks[i] |= 1 << j;
+                        if (field_masks[i])
+                                cargo_mask |= 1 << i;
+                }
+        if (cargo_mask)
+                mask |= 1 << G_SF_CARGO;
+        if (!mask)
+                return FALSE;
+
+        N_send_varint(ship + 1);
+        N_send_varint(mask);
+        for (i = 0; i < G_SF_CARGO; i++)
+                if (mask & (1 << i)) {
+                        N_send_varint(now->fields[i]);
+                        base->fields[i] = now->fields[i];
+                }
+        if (!cargo_mask)
+                return TRUE;
+        N_send_varint(cargo_mask);
+        for (i = 0; i < G_CARGO_TYPES; i++) {
+                if (!field_masks[i])
+                        continue;
+                N_send_varint(field_masks[i]);
+                for (j = 0; j < G_CARGO_FIELDS; j++)
+                        if (field_masks[i] & (1 << j)) {
+                                N_send_varint(now->cargo[i][j]);
+                                base->cargo[i][j] = now->cargo[i][j];
+                        }
+        }
+        return TRUE;
+}
+
+/******************************************************************************\
+ Send [client] every change it has not seen yet in the ships it is interested
+ in. Ships of reduced interest are only compared on a [refresh]. Otherwise
+ only the ships that changed are compared unless the client needs a resync.
+ The list of ships is terminated by a zero and split into several messages if
+ it gets too long.
+\******************************************************************************/
+static void send_client(n_client_id_t client, bool refresh)
+{
+        g_interest_t interest;
+        int i, ship, len;
+        bool started, all;
+
+        all = refresh || resync[client];
+        len = all ? g_ships_max : dirty_len;
+        for (started = FALSE, i = 0; i < len; i++) {
+                ship = all ? i : dirty[i];
+                if (!g_ships[ship].in_use)
+                        continue;
+                interest = G_ship_interest(ship, client);
+                if (interest == G_INTEREST_NONE ||
+                    (!refresh && interest != G_INTEREST_FULL))
+                        continue;
+
+                /* Finish the message if this ship might not fit */
+                if (started && N_send_size() > N_SYNC_MAX - SHIP_BYTES_MAX) {
+                        N_send_varint(0);
+                        N_send(client, NULL);
+                        started = FALSE;
+                }
+
+                if (!started) {
+                        N_send_start();
+                        N_send_char(G_SM_SNAPSHOT);
+                }
+                if (send_ship(client, ship))
+                        started = TRUE;
+        }
+        if (started) {
+                N_send_varint(0);
+                N_send(client, NULL);
+        }
+        resync[client] = FALSE;
+}
+
+/******************************************************************************\
+ Called once per host update after the ships have been updated. Sends every
+ remote client that is keeping up a snapshot of the changes. Backlogged
+ clients are skipped and compared against every ship once they catch up.
+ Every ship a client is interested in is compared on a [refresh]. Only the
+ ships that changed are encoded unless some client compares every ship.
+\******************************************************************************/
+void G_snapshot_send(bool refresh)
+{
+        int i;
+        bool all;
+
+        if (n_client_id != N_HOST_CLIENT_ID)
+                return;
+
+        /* Clients that are about to catch up compare every ship */
+        for (all = refresh, i = 0; !all && i < N_CLIENTS_MAX; i++)
+                all = resync[i] && n_clients[i].connected &&
+                      !n_clients[i].backlogged;
+        if (all) {
+                for (i = 0; i < g_ships_max; i++)
+                        if (g_ships[i].in_use)
+                                snapshot_ship(i, current + i);
+        } else
+                for (i = 0; i < dirty_len; i++)
+                        if (g_ships[dirty[i]].in_use)
+                                snapshot_ship(dirty[i], current + dirty[i]);
+
+        for (i = 0; i < N_CLIENTS_MAX; i++) {
+                if (i == N_HOST_CLIENT_ID || !n_clients[i].connected ||
+                    !baselines[i])
+                        continue;
+                if (n_clients[i].backlogged) {
+                        resync[i] = TRUE;
+                        continue;
+                }
+                send_client(i, refresh);
+        }
+        for (i = 0; i < dirty_len; i++)
+                queued[dirty[i]] = FALSE;
+        dirty_len = 0;
+}
@@ -77,8 +77,12 @@ int G_receive_ship_full(const char *file, int line, const char *func,
 {
         int index;
 
-        index = G_receive_range_full(file, line, func, client, 0, G_SHIPS_MAX);
-        if (index < 0 || !g_ships[index].in_use)
+        index = N_receive_short();
+        if (index < 0 || index >= g_ships_max) {
+                G_corrupt_drop_full(file, line, func, client);
+                return -1;
+        }
+        if (!g_ships[index].in_use)
                 return -1;
         return index;
 }
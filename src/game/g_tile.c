@@ -18,8 +18,28 @@ g_tile_t g_tiles[R_TILES_MAX];
 /* The tile the mouse is hovering over and the currently selected tile */
 int g_hover_tile, g_selected_tile;
 
-/* Number of gibs on the globe */
-int g_gibs;
+/* Building and gib structures are allocated from pools */
+c_pool_t g_building_pool, g_gib_pool;
+
+/******************************************************************************\
+ Initialize the building and gib pools.
+\******************************************************************************/
+void G_init_pools(void)
+{
+        C_pool_init(&g_building_pool, "buildings", g_building_t);
+        C_pool_init(&g_gib_pool, "gibs", g_gib_t);
+}
+
+/******************************************************************************\
+ Free the building and gib pools. Tiles must be cleaned up first.
+\******************************************************************************/
+void G_cleanup_pools(void)
+{
+        C_pool_stats(&g_building_pool);
+        C_pool_stats(&g_gib_pool);
+        C_pool_cleanup(&g_building_pool);
+        C_pool_cleanup(&g_gib_pool);
+}
 
 /******************************************************************************\
  Cleanup a building structure.
@@ -29,7 +49,7 @@ static void building_free(g_building_t *building)
         if (!building)
                 return;
         R_model_cleanup(&building->model);
-        C_free(building);
+        C_pool_free(&g_building_pool, building);
 }
 
 /******************************************************************************\
@@ -40,8 +60,7 @@ static void gib_free(g_gib_t *gib)
         if (!gib)
                 return;
         R_model_cleanup(&gib->model);
-        C_free(gib);
-        g_gibs--;
+        C_pool_free(&g_gib_pool, gib);
 }
 
 /******************************************************************************\
@@ -252,7 +271,8 @@ void G_tile_build(int tile, g_building_type_t type, g_nation_name_t nation)
 
         /* Allocate and initialize a building structure */
         else {
-                building = C_malloc(sizeof (*g_tiles[tile].building));
+                building = C_pool_alloc(&g_building_pool);
+                building->tile = tile;
                 building->type = type;
                 building->nation = nation;
                 building->health = g_building_classes[type].health;
@@ -267,12 +287,12 @@ void G_tile_build(int tile, g_building_type_t type, g_nation_name_t nation)
         }
 
         /* If we just built a new town hall, update the island */
-        if (type == G_BT_TOWN_HALL)
+        if (type == G_BT_TOWN_HALL && g_tiles[tile].island >= 0)
                 g_islands[g_tiles[tile].island].town_tile = tile;
 
-        /* Let all connected clients know about this */
+        /* Let interested clients know about this */
         if (g_host_inited)
-                G_tile_send_building(tile, N_BROADCAST_ID);
+                G_tile_broadcast_building(tile);
 }
 
 /******************************************************************************\
@@ -331,8 +351,8 @@ int G_tile_gib(int tile, g_gib_type_t type)
 
         gib_free(g_tiles[tile].gib);
         if (type != G_GT_NONE) {
-                g_gibs++;
-                g_tiles[tile].gib = (g_gib_t *)C_calloc(sizeof (g_gib_t));
+                g_tiles[tile].gib = C_pool_alloc(&g_gib_pool);
+                g_tiles[tile].gib->tile = tile;
                 g_tiles[tile].gib->type = type;
 
                 /* Initialize the model */
@@ -342,9 +362,9 @@ int G_tile_gib(int tile, g_gib_type_t type)
         } else
                 g_tiles[tile].gib = NULL;
 
-        /* Let all connected clients know about this gib */
+        /* Let interested clients know about this gib */
         if (g_host_inited)
-                G_tile_send_gib(tile, N_BROADCAST_ID);
+                G_tile_broadcast_gib(tile);
 
         return tile;
 }
@@ -13,7 +13,7 @@
 #include "g_common.h"
 
 /* Game testing */
-c_var_t g_debug_net, g_test_globe;
+c_var_t g_debug_net, g_test_globe, g_test_paths;
 
 /* Globe variables */
 c_var_t g_forest, g_globe_seed, g_globe_subdiv4, g_island_num, g_island_size,
@@ -26,7 +26,7 @@ c_var_t g_nation_colors[G_NATION_NAMES];
 c_var_t g_draw_distance, g_name;
 
 /* Server settings */
-c_var_t g_players, g_time_limit, g_victory_gold;
+c_var_t g_players, g_ship_num, g_tick_rate, g_time_limit, g_victory_gold;
 
 /* Master server */
 c_var_t g_master, g_master_url;
@@ -40,6 +40,9 @@ void G_register_variables(void)
         C_register_integer(&g_test_globe, "g_test_globe", FALSE,
                            "test globe tile click detection");
         g_test_globe.edit = C_VE_ANYTIME;
+        C_register_integer(&g_test_paths, "g_test_paths", 0,
+                           "number of path searches to time per globe size");
+        g_test_paths.archive = FALSE;
         C_register_integer(&g_debug_net, "g_debug_net", FALSE,
                            "log network messages");
         g_debug_net.edit = C_VE_ANYTIME;
@@ -78,10 +81,14 @@ void G_register_variables(void)
         /* Server settings */
         C_register_integer(&g_players, "g_players", 12,
                            "maximum number of players");
+        C_register_integer(&g_ship_num, "g_ships", 128,
+                           "maximum number of ships");
         C_register_integer(&g_time_limit, "g_time_limit", 45,
                            "minutes after which game ends");
         C_register_integer(&g_victory_gold, "g_victory_gold", 30000,
                            "gold a team needs to win the game");
+        C_register_integer(&g_tick_rate, "g_tick_rate", 20,
+                           "game updates per second");
 
         /* Master server */
         C_register_string(&g_master, "g_master", "master.plutocracy.ca",
@@ -41,6 +41,9 @@ void N_cleanup(void)
         WSACleanup();
 #endif
         N_stop_server();
+        N_thread_cleanup();
+        N_cleanup_queues();
+        N_poll_cleanup();
 }
 
 /******************************************************************************\
@@ -80,6 +83,7 @@ void N_disconnect(void)
                 n_clients[N_SERVER_ID].socket = INVALID_SOCKET;
         }
         n_clients[N_SERVER_ID].connected = FALSE;
+        N_send_queue_clear(N_SERVER_ID);
         n_client_id = N_INVALID_ID;
         C_debug("Disconnected from server");
 }
@@ -98,12 +102,16 @@ void N_poll_client(void)
                         return;
                 }
                 n_clients[N_SERVER_ID].connected = TRUE;
-                n_clients[N_SERVER_ID].buffer_len = 0;
+                N_send_queue_clear(N_SERVER_ID);
+                n_clients[N_SERVER_ID].recv_start = 0;
+                n_clients[N_SERVER_ID].recv_end = 0;
                 n_client_id = N_UNASSIGNED_ID;
                 n_client_func(N_SERVER_ID, N_EV_CONNECTED);
                 return;
         }
 
+        N_stats_update();
+
         /* Send and receive data */
         if (!N_send_buffer(N_SERVER_ID) || !N_receive(N_SERVER_ID))
                 N_disconnect();
@@ -21,6 +21,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/select.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -35,9 +36,35 @@
 typedef int socklen_t;
 #endif
 
+/* Most messages handed to the socket in a single call */
+#define N_SEND_VECTOR_MAX 64
+
 /* Connection timeout in milliseconds */
 #define CONNECT_TIMEOUT 5000
 
+/* Poll tags for sockets that are not client sockets. Client sockets are
+   tagged with their client id. */
+#define N_POLL_LISTEN N_CLIENTS_MAX
+#define N_POLL_HTTP (N_CLIENTS_MAX + 1)
+#define N_POLL_MAX (N_CLIENTS_MAX + 2)
+
+/* Poll event flags */
+#define N_POLL_READ 1
+#define N_POLL_WRITE 2
+
+/* Ready socket returned by N_poll_wait() */
+typedef struct n_poll_event {
+        int tag, events;
+} n_poll_event_t;
+
+/* n_http.c */
+void N_watch_http(void);
+
+/* n_poll.c */
+void N_poll_cleanup(void);
+void N_poll_set(int tag, SOCKET, int events);
+const n_poll_event_t *N_poll_wait(int timeout, int *len);
+
 /* n_socket.c */
 SOCKET N_connect_socket(const char *address, int port);
 SOCKET N_client_to_socket(n_client_id_t);
@@ -45,13 +72,37 @@ const char *N_socket_error(int return_value);
 void N_socket_no_block(SOCKET);
 bool N_socket_select(SOCKET, int timeout);
 int N_socket_send(SOCKET, const char *data, int size);
+int N_socket_send_vector(SOCKET, const char **data, const int *sizes,
+                         int count);
+
+/* n_stats.c */
+void N_stats_flushed(n_client_id_t, int latency);
+void N_stats_queued(n_client_id_t, const char *data, int size, int depth,
+                    int queued);
+void N_stats_received(n_client_id_t, const char *data, int size);
+void N_stats_update(void);
 
 /* n_sync.c */
+void N_cleanup_queues(void);
 bool N_receive(int client);
+bool N_receive_buffered(n_client_id_t);
+int N_receive_socket(n_client_id_t, const char **error);
 bool N_send_buffer(int client);
+void N_send_queue_clear(int client);
+void N_watch_client(n_client_id_t);
 
 extern n_callback_f n_client_func, n_server_func;
 
+/* n_thread.c */
+void N_lock(void);
+void N_thread_cleanup(void);
+bool N_thread_running(void);
+bool N_thread_self(void);
+void N_thread_start(void);
+void N_thread_stop(void);
+void N_thread_wait(int msec, bool *listen, bool *http);
+void N_unlock(void);
+
 /* n_variables.c */
-extern c_var_t n_port;
+extern c_var_t n_port, n_send_high, n_send_low, n_send_max, n_thread;
 
@@ -15,11 +15,27 @@
 /* This file handles the HTTP connection */
 
 static n_callback_http_f http_func;
-static SOCKET http_socket;
+static SOCKET http_socket = INVALID_SOCKET;
 static int http_connect_time, http_buffer_len, http_port;
 static char http_address[32], http_buffer[4096], http_host[256];
 static bool http_connected;
 
+/******************************************************************************\
+ Update what the host's poll loop waits on for the HTTP socket. Writability
+ signals that the connection completed or that buffered data can be sent.
+\******************************************************************************/
+void N_watch_http(void)
+{
+        int events;
+
+        if (http_socket == INVALID_SOCKET)
+                return;
+        events = N_POLL_READ;
+        if (!http_connected || http_buffer_len > 0)
+                events |= N_POLL_WRITE;
+        N_poll_set(N_POLL_HTTP, http_socket, events);
+}
+
 /******************************************************************************\
  Starts connecting to the HTTP server.
 \******************************************************************************/
@@ -37,6 +53,7 @@ void N_connect_http(const char *address, n_callback_http_f callback)
         http_func = callback;
         http_socket = N_connect_socket(http_address, http_port);
         http_connect_time = c_time_msec;
+        N_watch_http();
 }
 
 /******************************************************************************\
@@ -55,17 +72,16 @@ bool N_connect_http_wait(const char *address, n_callback_http_f callback)
 \******************************************************************************/
 void N_disconnect_http(void)
 {
-        if (!http_connected)
+        if (http_socket == INVALID_SOCKET)
                 return;
         if (http_connected)
                 http_func(N_EV_DISCONNECTED, NULL, -1);
         else
                 http_func(N_EV_CONNECT_FAILED, NULL, -1);
         http_connected = FALSE;
-        if (http_socket != INVALID_SOCKET) {
-                closesocket(http_socket);
-                http_socket = INVALID_SOCKET;
-        }
+        N_poll_set(N_POLL_HTTP, INVALID_SOCKET, 0);
+        closesocket(http_socket);
+        http_socket = INVALID_SOCKET;
         C_debug("Closed HTTP connection");
 }
 
@@ -98,7 +114,10 @@ void N_poll_http(void)
 
                 /* Success! */
                 http_connected = TRUE;
+                N_watch_http();
                 http_func(N_EV_CONNECTED, NULL, -1);
+                if (http_socket == INVALID_SOCKET)
+                        return;
         }
 
         /* Overflow */
@@ -115,7 +134,14 @@ void N_poll_http(void)
 
                 ret = N_socket_send(http_socket, http_buffer, http_buffer_len);
                 if (ret > 0) {
-                        http_buffer_len = 0;
+                        http_buffer_len -= ret;
+                        memmove(http_buffer, http_buffer + ret,
+                                http_buffer_len);
+                        N_watch_http();
+
+                        /* Wait until the rest of the buffer is sent */
+                        if (http_buffer_len > 0)
+                                return;
                         http_func(N_EV_SEND_COMPLETE, NULL, -1);
                         if (http_socket == INVALID_SOCKET)
                                 return;
@@ -233,6 +259,8 @@ void N_send_get(const char *url)
                                     "Host: %s:%d\n"
                                     "Connection: close\n\n",
                                     url, http_host, http_port);
+        if (http_socket != INVALID_SOCKET)
+                N_watch_http();
 }
 
 /******************************************************************************\
@@ -295,5 +323,7 @@ void N_send_post_full(const char *url, ...)
                                     " application/x-www-form-urlencoded\n"
                                     "Content-Length: %d\n\n%s",
                                     url, http_host, http_port, text_len, text);
+        if (http_socket != INVALID_SOCKET)
+                N_watch_http();
 }
 
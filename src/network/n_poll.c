@@ -0,0 +1,235 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* Waits on every watched socket at once and reports which ones are ready.
+   Uses epoll on Linux, poll() on other POSIX systems and select() on
+   Windows. Sockets may be watched from the main thread while the network
+   thread is waiting, so the watch table is only touched under the network
+   lock. */
+
+#include "n_common.h"
+
+#if defined(WINDOWS)
+#define POLL_SELECT
+#elif defined(__linux__)
+#define POLL_EPOLL
+#include <sys/epoll.h>
+#else
+#define POLL_POLL
+#include <poll.h>
+#endif
+
+/* Watched sockets, indexed by tag */
+typedef struct poll_watch {
+        SOCKET socket;
+        int events;
+} poll_watch_t;
+
+static poll_watch_t watches[N_POLL_MAX];
+static n_poll_event_t ready[N_POLL_MAX];
+static bool watches_inited;
+
+#ifdef POLL_EPOLL
+static int epoll_fd = -1;
+#endif
+
+/******************************************************************************\
+ Initialize the watch table the first time it is used.
+\******************************************************************************/
+static void init_watches(void)
+{
+        int i;
+
+        if (watches_inited)
+                return;
+        for (i = 0; i < N_POLL_MAX; i++) {
+                watches[i].socket = INVALID_SOCKET;
+                watches[i].events = 0;
+        }
+#ifdef POLL_EPOLL
+        if ((epoll_fd = epoll_create(N_POLL_MAX)) < 0)
+                C_error("Failed to create epoll instance: %s",
+                        strerror(errno));
+#endif
+        watches_inited = TRUE;
+}
+
+/******************************************************************************\
+ Start, change or stop watching a socket. The [tag] identifies the socket in
+ the events returned by N_poll_wait(). Pass INVALID_SOCKET or no [events] to
+ stop watching. Sockets must be unwatched before they are closed.
+\******************************************************************************/
+void N_poll_set(int tag, SOCKET socket, int events)
+{
+        poll_watch_t *watch;
+
+        C_assert(tag >= 0 && tag < N_POLL_MAX);
+        init_watches();
+        N_lock();
+        watch = watches + tag;
+        if (socket == INVALID_SOCKET)
+                events = 0;
+        if (watch->socket == socket && watch->events == events) {
+                N_unlock();
+                return;
+        }
+
+#ifdef POLL_EPOLL
+{
+        struct epoll_event ev;
+
+        C_zero(&ev);
+        if (watch->events && (watch->socket != socket || !events))
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, watch->socket, &ev);
+        if (events) {
+                ev.data.u32 = tag;
+                if (events & N_POLL_READ)
+                        ev.events |= EPOLLIN;
+                if (events & N_POLL_WRITE)
+                        ev.events |= EPOLLOUT;
+                if (epoll_ctl(epoll_fd, watch->events &&
+                              watch->socket == socket ? EPOLL_CTL_MOD :
+                                                        EPOLL_CTL_ADD,
+                              socket, &ev))
+                        C_warning("Failed to watch socket: %s",
+                                  strerror(errno));
+        }
+}
+#endif
+
+        watch->socket = events ? socket : INVALID_SOCKET;
+        watch->events = events;
+        N_unlock();
+}
+
+/******************************************************************************\
+ Wait up to [timeout] milliseconds for any watched socket to become ready.
+ Returns the ready sockets and stores how many there are in [len].
+\******************************************************************************/
+const n_poll_event_t *N_poll_wait(int timeout, int *len)
+{
+        int i, n;
+
+        init_watches();
+        *len = 0;
+
+#if defined(POLL_EPOLL)
+{
+        struct epoll_event evs[N_POLL_MAX];
+
+        n = epoll_wait(epoll_fd, evs, N_POLL_MAX, timeout);
+        for (i = 0; i < n; i++) {
+                ready[i].tag = evs[i].data.u32;
+                ready[i].events = 0;
+                if (evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                        ready[i].events |= N_POLL_READ;
+                if (evs[i].events & EPOLLOUT)
+                        ready[i].events |= N_POLL_WRITE;
+        }
+        if (n > 0)
+                *len = n;
+}
+#elif defined(POLL_POLL)
+{
+        struct pollfd fds[N_POLL_MAX];
+        int tags[N_POLL_MAX];
+
+        N_lock();
+        for (n = i = 0; i < N_POLL_MAX; i++) {
+                if (!watches[i].events)
+                        continue;
+                fds[n].fd = watches[i].socket;
+                fds[n].events = 0;
+                fds[n].revents = 0;
+                if (watches[i].events & N_POLL_READ)
+                        fds[n].events |= POLLIN;
+                if (watches[i].events & N_POLL_WRITE)
+                        fds[n].events |= POLLOUT;
+                tags[n++] = i;
+        }
+        N_unlock();
+        if (poll(fds, n, timeout) <= 0)
+                return ready;
+        for (i = 0; i < n; i++) {
+                if (!fds[i].revents)
+                        continue;
+                ready[*len].tag = tags[i];
+                ready[*len].events = 0;
+                if (fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+                        ready[*len].events |= N_POLL_READ;
+                if (fds[i].revents & POLLOUT)
+                        ready[*len].events |= N_POLL_WRITE;
+                (*len)++;
+        }
+}
+#else
+{
+        struct timeval tv;
+        fd_set read_fds, write_fds;
+
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        N_lock();
+        for (n = i = 0; i < N_POLL_MAX; i++) {
+                if (watches[i].events & N_POLL_READ)
+                        FD_SET(watches[i].socket, &read_fds);
+                if (watches[i].events & N_POLL_WRITE)
+                        FD_SET(watches[i].socket, &write_fds);
+                if (watches[i].events)
+                        n++;
+        }
+        N_unlock();
+
+        /* Windows select() fails on empty sets */
+        if (!n) {
+                if (timeout > 0)
+                        SDL_Delay(timeout);
+                return ready;
+        }
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        if (select(0, &read_fds, &write_fds, NULL,
+                   timeout < 0 ? NULL : &tv) <= 0)
+                return ready;
+        N_lock();
+        for (i = 0; i < N_POLL_MAX; i++) {
+                if (!watches[i].events)
+                        continue;
+                ready[*len].tag = i;
+                ready[*len].events = 0;
+                if (FD_ISSET(watches[i].socket, &read_fds))
+                        ready[*len].events |= N_POLL_READ;
+                if (FD_ISSET(watches[i].socket, &write_fds))
+                        ready[*len].events |= N_POLL_WRITE;
+                if (ready[*len].events)
+                        (*len)++;
+        }
+        N_unlock();
+}
+#endif
+
+        return ready;
+}
+
+/******************************************************************************\
+ Stop watching all sockets and release the polling resources.
+\******************************************************************************/
+void N_poll_cleanup(void)
+{
+        if (!watches_inited)
+                return;
+#ifdef POLL_EPOLL
+        close(epoll_fd);
+        epoll_fd = -1;
+#endif
+        watches_inited = FALSE;
+}
@@ -28,10 +28,12 @@ void N_stop_server(void)
 
         if (n_client_id != N_HOST_CLIENT_ID)
                 return;
+        N_thread_stop();
         n_server_func(N_HOST_CLIENT_ID, N_EV_DISCONNECTED);
         n_client_id = N_INVALID_ID;
 
         /* Close listen server socket */
+        N_poll_set(N_POLL_LISTEN, INVALID_SOCKET, 0);
         if (listen_socket != INVALID_SOCKET)
                 closesocket(listen_socket);
         listen_socket = INVALID_SOCKET;
@@ -39,9 +41,13 @@ void N_stop_server(void)
         /* Disconnect any active clients */
         for (i = 0; i < N_CLIENTS_MAX; i++)
                 if (n_clients[i].connected) {
+                        if (i != N_HOST_CLIENT_ID)
+                                N_poll_set(i, INVALID_SOCKET, 0);
                         closesocket(n_clients[i].socket);
                         n_clients[i].connected = FALSE;
                 }
+        for (i = 0; i <= N_CLIENTS_MAX; i++)
+                N_send_queue_clear(i);
 
         C_debug("Stopped listen server");
 }
@@ -66,13 +72,12 @@ int N_start_server(n_callback_f server_func, n_callback_f client_func)
         n_client_id = N_HOST_CLIENT_ID;
         n_server_func = server_func;
         n_client_func = client_func;
+        N_cleanup_queues();
         C_zero(&n_clients);
 
         /* Setup the host's client */
         n_clients[N_HOST_CLIENT_ID].connected = TRUE;
-        n_clients[N_HOST_CLIENT_ID].buffer_len = 0;
         n_clients[N_SERVER_ID].connected = TRUE;
-        n_clients[N_SERVER_ID].buffer_len = 0;
         n_clients_num = 1;
         n_server_func(N_HOST_CLIENT_ID, N_EV_CONNECTED);
         n_client_func(N_SERVER_ID, N_EV_CONNECTED);
@@ -100,14 +105,80 @@ int N_start_server(n_callback_f server_func, n_callback_f client_func)
                 return FALSE;
         }
         N_socket_no_block(listen_socket);
+        N_poll_set(N_POLL_LISTEN, listen_socket, N_POLL_READ);
         C_debug("Started listen server");
+        N_thread_start();
         return TRUE;
 }
 
 /******************************************************************************\
- Accept any incoming connections.
+ Act as a host that makes connections to another server instead of accepting
+ them. Every connection gets a client slot and whatever the server sends over
+ it is passed to [bot_func] as if that client had sent it. There is no local
+ client. Used to put a server under load from a single process.
 \******************************************************************************/
-static void accept_connections(void)
+void N_start_bots(n_callback_f bot_func)
+{
+        N_disconnect();
+        n_client_id = N_HOST_CLIENT_ID;
+        n_server_func = bot_func;
+        n_client_func = NULL;
+        N_cleanup_queues();
+        C_zero(&n_clients);
+        n_clients_num = 0;
+        C_debug("Started bots");
+}
+
+/******************************************************************************\
+ Connect another bot to the server at [address]. Blocks until the connection
+ is made. Returns the bot's client slot or N_INVALID_ID if it failed.
+\******************************************************************************/
+n_client_id_t N_connect_bot(const char *address)
+{
+        SOCKET socket;
+        int i, port;
+        char ip[32];
+
+        if (n_client_id != N_HOST_CLIENT_ID)
+                return N_INVALID_ID;
+
+        /* The host's slot is never used */
+        for (i = N_HOST_CLIENT_ID + 1; n_clients[i].connected; i++)
+                if (i >= N_CLIENTS_MAX - 1) {
+                        C_warning("No client slots left for bots");
+                        return N_INVALID_ID;
+                }
+
+        /* Resolve the hostname and connect */
+        C_var_unlatch(&n_port);
+        port = n_port.value.n;
+        if (!N_resolve_buf(ip, &port, address))
+                return N_INVALID_ID;
+        if ((socket = N_connect_socket(ip, port)) == INVALID_SOCKET)
+                return N_INVALID_ID;
+        if (!N_socket_select(socket, CONNECT_TIMEOUT / 1000)) {
+                C_warning("Bot timed out connecting to '%s'", address);
+                closesocket(socket);
+                return N_INVALID_ID;
+        }
+
+        /* Initialize the client */
+        n_clients[i].connected = TRUE;
+        n_clients[i].compress = FALSE;
+        n_clients[i].lost = FALSE;
+        N_send_queue_clear(i);
+        n_clients[i].recv_start = n_clients[i].recv_end = 0;
+        n_clients[i].socket = socket;
+        n_clients_num++;
+        N_poll_set(i, socket, N_POLL_READ);
+        n_server_func(i, N_EV_CONNECTED);
+        return i;
+}
+
+/******************************************************************************\
+ Accept an incoming connection. Returns FALSE if there were none waiting.
+\******************************************************************************/
+static bool accept_connection(void)
 {
         struct sockaddr_in addr;
         socklen_t socklen;
@@ -117,24 +188,29 @@ static void accept_connections(void)
         socklen = sizeof (addr);
         if ((socket = accept(listen_socket, (struct sockaddr *)&addr,
                              &socklen)) == INVALID_SOCKET)
-                return;
+                return FALSE;
 
         /* Find a client id for this client */
         for (i = 0; n_clients[i].connected; i++)
                 if (i >= N_CLIENTS_MAX) {
                         C_debug("Server full, rejected new connection");
                         closesocket(socket);
-                        return;
+                        return TRUE;
                 }
         C_debug("Connected '%s' as client %d", inet_ntoa(addr.sin_addr), i);
         N_socket_no_block(socket);
 
         /* Initialize the client */
         n_clients[i].connected = TRUE;
-        n_clients[i].buffer_len = 0;
+        n_clients[i].compress = FALSE;
+        n_clients[i].lost = FALSE;
+        N_send_queue_clear(i);
+        n_clients[i].recv_start = n_clients[i].recv_end = 0;
         n_clients[i].socket = socket;
         n_clients_num++;
+        N_poll_set(i, socket, N_POLL_READ);
         n_server_func(i, N_EV_CONNECTED);
+        return TRUE;
 }
 
 /******************************************************************************\
@@ -154,36 +230,122 @@ void N_drop_client(int client)
                 C_warning("Tried to drop unconnected client %d", client);
                 return;
         }
+        N_lock();
         n_clients[client].connected = FALSE;
-        n_clients[client].buffer_len = 0;
+        N_send_queue_clear(client);
+        n_clients[client].recv_start = n_clients[client].recv_end = 0;
         n_clients_num--;
 
         /* The server kicked itself */
         if (client == n_client_id) {
+                N_unlock();
                 N_disconnect();
                 C_debug("Server dropped itself");
                 return;
         }
 
         n_server_func(client, N_EV_DISCONNECTED);
+        N_poll_set(client, INVALID_SOCKET, 0);
         closesocket(n_clients[client].socket);
+        N_unlock();
         C_debug("Dropped client %d", client);
 }
 
 /******************************************************************************\
- Poll connections and dispatch any messages that arrive.
+ Dispatch what the network thread has received and drop the clients it found
+ disconnected. Sockets it handed over are serviced here and watched again.
 \******************************************************************************/
-void N_poll_server(void)
+static void poll_thread(int msec)
 {
         int i;
+        bool listen, http;
+
+        N_thread_wait(msec, &listen, &http);
+        if (listen) {
+                while (accept_connection());
+                N_poll_set(N_POLL_LISTEN, listen_socket, N_POLL_READ);
+        }
+        if (http) {
+                N_poll_http();
+                N_watch_http();
+        }
+        for (i = 0; i < N_CLIENTS_MAX; i++) {
+                if (i == N_HOST_CLIENT_ID || !n_clients[i].connected)
+                        continue;
+                if (n_clients[i].lost) {
+                        C_debug("Lost connection to %s",
+                                N_client_to_string(i));
+                        N_drop_client(i);
+                } else if (!N_receive_buffered(i))
+                        N_drop_client(i);
+                else
+                        N_watch_client(i);
+
+                /* The host may have been stopped in response to a message */
+                if (n_client_id != N_HOST_CLIENT_ID)
+                        return;
+        }
+}
+
+/******************************************************************************\
+ Wait up to [msec] milliseconds for network activity, then accept connections
+ and dispatch any messages that arrive. Only sockets that are ready are
+ touched. A dedicated server can block here until there is work to do. If the
+ network thread is running, it does the waiting and reading.
+\******************************************************************************/
+void N_poll_server_wait(int msec)
+{
+        const n_poll_event_t *events;
+        int i, len;
 
         if (n_client_id != N_HOST_CLIENT_ID)
                 return;
-        accept_connections();
+        N_lock();
+        N_stats_update();
 
-        /* Send to and receive from clients */
-        for (i = 0; i < N_CLIENTS_MAX; i++)
-                if (!N_send_buffer(i) || !N_receive(i))
-                        N_drop_client(i);
-}
+        /* The local client's messages are queued in memory */
+        if (!N_receive(N_HOST_CLIENT_ID))
+                N_drop_client(N_HOST_CLIENT_ID);
+        if (n_client_id != N_HOST_CLIENT_ID) {
+                N_unlock();
+                return;
+        }
+
+        if (N_thread_running()) {
+                poll_thread(msec);
+                N_unlock();
+                return;
+        }
+
+        events = N_poll_wait(msec, &len);
+        for (i = 0; i < len; i++) {
+                int tag;
+
+                tag = events[i].tag;
 
+                /* Incoming connections */
+                if (tag == N_POLL_LISTEN) {
+                        while (accept_connection());
+                        continue;
+                }
+
+                /* Master server connection */
+                if (tag == N_POLL_HTTP) {
+                        N_poll_http();
+                        continue;
+                }
+
+                /* Send to and receive from clients */
+                if (!n_clients[tag].connected)
+                        continue;
+                if (((events[i].events & N_POLL_WRITE) &&
+                     !N_send_buffer(tag)) ||
+                    ((events[i].events & N_POLL_READ) && !N_receive(tag)))
+                        N_drop_client(tag);
+
+                /* The host may have been stopped in response to a message */
+                if (n_client_id != N_HOST_CLIENT_ID)
+                        break;
+        }
+        N_unlock();
+}
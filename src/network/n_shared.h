@@ -10,9 +10,19 @@
  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
 \******************************************************************************/
 
-/* Largest amount of data that can be sent via a message */
+/* Largest amount of data that can be sent via a message. Must stay below
+   32768 because the top bit of a message's size marks compressed batches. */
 #define N_SYNC_MAX 32000
 
+/* Size of each client's receive buffer, must be able to hold at least one
+   complete message after a partial one */
+#define N_RECV_MAX (N_SYNC_MAX * 2)
+
+/* Number of message types counted separately in the network statistics.
+   Messages are typed by their first byte and higher types share the last
+   slot. */
+#define N_MESSAGE_TYPES 32
+
 /* Sentinel added to the end of N_send_full() calls */
 #define N_SENTINEL -1234567890
 
@@ -46,15 +56,39 @@ typedef enum {
 /* Client/server network callback function */
 typedef void (*n_callback_f)(n_client_id_t, n_event_t);
 
+/* Converts a message type to a string for the network statistics */
+typedef const char *(*n_message_name_f)(int type);
+
 /* HTTP network callback function */
 typedef void (*n_callback_http_f)(n_event_t, const char *text, int length);
 
-/* Structure for connected clients */
+/* A finished outgoing message. Messages are never modified once they are
+   built. Every send queue the message is in holds a reference to it and the
+   message is freed when the last one is released. The [time] the message was
+   finished is kept to measure how long it waits to be sent. It is read from
+   SDL_GetTicks() because messages are flushed from the network thread, which
+   cannot read the main thread's frame time. */
+typedef struct n_message {
+        int refs, size, time;
+        char data[];
+} n_message_t;
+
+/* Structure for connected clients. A client is [backlogged] once its send
+   queue grows past the high watermark, until it drains below the low
+   watermark. Non-critical updates should be deferred while it is. Messages
+   queued for the client are only compressed if [compress] is set, except for
+   the first [send_plain] which were queued before it was. The send queue is a
+   ring of [send_num] messages starting at [send_first], of which the first
+   [send_pos] bytes have already been sent. A client is [lost] when the
+   network thread finds its connection closed, until the main thread drops
+   it. */
 typedef struct n_client {
         SOCKET socket;
-        int buffer_len;
-        char buffer[N_SYNC_MAX];
-        bool connected, selected;
+        n_message_t **send_queue;
+        int send_queue_size, send_first, send_num, send_pos, send_plain,
+            send_len, recv_start, recv_end;
+        char recv_buffer[N_RECV_MAX];
+        bool backlogged, compress, connected, lost, selected;
 } n_client_t;
 
 /* n_client.c */
@@ -80,14 +114,21 @@ void N_send_get(const char *url);
 void N_send_post_full(const char *url, ...);
 
 /* n_server.c */
+n_client_id_t N_connect_bot(const char *address);
 void N_drop_client(n_client_id_t);
-void N_poll_server(void);
+#define N_poll_server() N_poll_server_wait(0)
+void N_poll_server_wait(int msec);
+void N_start_bots(n_callback_f bot_func);
 int N_start_server(n_callback_f server, n_callback_f client);
 void N_stop_server(void);
 
 extern n_client_t n_clients[N_CLIENTS_MAX + 1];
 extern int n_clients_num;
 
+/* n_stats.c */
+void N_stats_dump(const char *filename);
+void N_stats_names(n_message_name_f server, n_message_name_f client);
+
 /* n_sync.c */
 #define N_broadcast(f, ...) \
         N_send_full(__FILE__, __LINE__, __func__, N_BROADCAST_ID, f, \
@@ -95,11 +136,13 @@ extern int n_clients_num;
 #define N_broadcast_except(c, f, ...) \
         N_send_full(__FILE__, __LINE__, __func__, -(c) - 1, f, \
                     ## __VA_ARGS__, N_SENTINEL)
+void N_compress_client(n_client_id_t, bool compress);
 char N_receive_char(void);
 float N_receive_float(void);
 int N_receive_int(void);
 short N_receive_short(void);
 void N_receive_string(char *buffer, int size);
+int N_receive_varint(void);
 #define N_receive_string_buf(b) N_receive_string(b, sizeof (b))
 #define N_send(n, fmt, ...) N_send_full(__FILE__, __LINE__, __func__, n, fmt, \
                                         ## __VA_ARGS__, N_SENTINEL);
@@ -113,11 +156,16 @@ bool N_send_int(int);
 bool N_send_float(float);
 void N_send_full(const char *file, int line, const char *func,
                  n_client_id_t, const char *format, ...);
+int N_send_size(void);
 void N_send_start(void);
 bool N_send_string(const char *);
+bool N_send_varint(int);
+
+extern c_count_t n_count_compressed, n_count_uncompressed;
 
 /* n_variables.c */
 void N_register_variables(void);
 
-extern c_var_t n_port;
+extern c_var_t n_compress, n_port, n_send_high, n_send_low, n_send_max,
+               n_stats, n_stats_file, n_stats_interval, n_thread;
 
@@ -85,30 +85,71 @@ SOCKET N_connect_socket(const char *address, int port)
 }
 
 /******************************************************************************\
- Send generic data over a socket. Returns FALSE if there was an error.
+ Send generic data over a socket. Returns the number of bytes sent, which may
+ be less than [size] or zero if the socket is not ready. Returns negative if
+ there was an error.
 \******************************************************************************/
 int N_socket_send(SOCKET socket, const char *data, int size)
 {
         int ret;
         const char *error;
 
-        /* Ready to write? */
-        if (!N_socket_select(socket, 0))
-                return 0;
-
-        /* Try sending */
+        /* Sockets are non-blocking, so there is no need to select() first */
         ret = send(socket, data, size, 0);
         if ((error = N_socket_error(ret))) {
-                C_warning("Send error: %s", error);
+                if (!N_thread_self())
+                        C_warning("Send error: %s", error);
                 return -1;
         }
 
-        /* Did we send all of it? */
-        if (ret >= size)
-                return ret;
+        /* Would have blocked */
+        if (ret < 0)
+                return 0;
+        return ret;
+}
 
-        /* Didn't send it */
-        return 0;
+/******************************************************************************\
+ Send [count] separate buffers over a socket in order, with a single call
+ where the system supports it. Returns the total number of bytes sent, which
+ may stop partway through any buffer, or negative if there was an error.
+\******************************************************************************/
+int N_socket_send_vector(SOCKET socket, const char **data, const int *sizes,
+                         int count)
+{
+#ifdef WINDOWS
+        int i, ret, total;
+
+        /* WinSock 1 has no gathering send */
+        for (total = i = 0; i < count; i++) {
+                if ((ret = N_socket_send(socket, data[i], sizes[i])) < 0)
+                        return -1;
+                total += ret;
+                if (ret < sizes[i])
+                        break;
+        }
+        return total;
+#else
+        struct iovec iov[N_SEND_VECTOR_MAX];
+        int i, ret;
+        const char *error;
+
+        C_assert(count <= N_SEND_VECTOR_MAX);
+        for (i = 0; i < count; i++) {
+                iov[i].iov_base = (void *)data[i];
+                iov[i].iov_len = sizes[i];
+        }
+        ret = (int)writev(socket, iov, count);
+        if ((error = N_socket_error(ret))) {
+                if (!N_thread_self())
+                        C_warning("Send error: %s", error);
+                return -1;
+        }
+
+        /* Would have blocked */
+        if (ret < 0)
+                return 0;
+        return ret;
+#endif
 }
 
 /******************************************************************************\
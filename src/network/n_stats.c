@@ -0,0 +1,247 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* Counts the messages and bytes of each type sent to and received from each
+   client slot, along with how deep each send queue got and how long messages
+   waited in it. Messages are typed by their first byte. */
+
+#include "n_common.h"
+
+/* Traffic of one message type in one direction */
+typedef struct stats_count {
+        unsigned int messages, bytes;
+} stats_count_t;
+
+/* Everything counted for one client slot since the network was started */
+typedef struct stats_client {
+        stats_count_t sent[N_MESSAGE_TYPES], received[N_MESSAGE_TYPES];
+        unsigned int flushed, latency_total;
+        int depth_max, queued_max, latency_max;
+} stats_client_t;
+
+static stats_client_t stats[N_CLIENTS_MAX + 1];
+static n_message_name_f server_names, client_names;
+static int dump_time;
+
+/******************************************************************************\
+ Returns the slot a message is counted in.
+\******************************************************************************/
+static int message_type(const char *data, int size)
+{
+        int type;
+
+        if (size < 3)
+                return 0;
+        type = (unsigned char)data[2];
+        return type < N_MESSAGE_TYPES ? type : N_MESSAGE_TYPES - 1;
+}
+
+/******************************************************************************\
+ Called when a message of [size] bytes is queued for [client]. The client now
+ has [depth] messages and [queued] bytes waiting to be sent.
+\******************************************************************************/
+void N_stats_queued(n_client_id_t client, const char *data, int size,
+                    int depth, int queued)
+{
+        stats_client_t *sc;
+        stats_count_t *count;
+
+        sc = stats + client;
+        count = sc->sent + message_type(data, size);
+        count->messages++;
+        count->bytes += size;
+        if (depth > sc->depth_max)
+                sc->depth_max = depth;
+        if (queued > sc->queued_max)
+                sc->queued_max = queued;
+}
+
+/******************************************************************************\
+ Called when a message for [client] has been sent completely, [latency]
+ milliseconds after it was queued.
+\******************************************************************************/
+void N_stats_flushed(n_client_id_t client, int latency)
+{
+        stats_client_t *sc;
+
+        sc = stats + client;
+        if (latency < 0)
+                latency = 0;
+        sc->flushed++;
+        sc->latency_total += latency;
+        if (latency > sc->latency_max)
+                sc->latency_max = latency;
+}
+
+/******************************************************************************\
+ Called when a message of [size] bytes from [client] is dispatched.
+\******************************************************************************/
+void N_stats_received(n_client_id_t client, const char *data, int size)
+{
+        stats_count_t *count;
+
+        count = stats[client].received + message_type(data, size);
+        count->messages++;
+        count->bytes += size;
+}
+
+/******************************************************************************\
+ Set the functions that convert message types to names for the output. Only
+ the server sends server messages and only clients send client messages.
+\******************************************************************************/
+void N_stats_names(n_message_name_f server, n_message_name_f client)
+{
+        server_names = server;
+        client_names = client;
+}
+
+/******************************************************************************\
+ Returns the name of message [type] going to or coming from [client].
+\******************************************************************************/
+static const char *type_name(n_client_id_t client, bool sent, int type)
+{
+        n_message_name_f func;
+
+        /* Messages to the server and from clients are client messages */
+        func = (client == N_SERVER_ID) == sent ? client_names : server_names;
+        if (type == N_MESSAGE_TYPES - 1)
+                return C_va("%d+", type);
+        if (!func)
+                return C_va("%d", type);
+        return func(type);
+}
+
+/******************************************************************************\
+ Returns TRUE if anything was ever sent to or received from [client].
+\******************************************************************************/
+static bool client_active(n_client_id_t client)
+{
+        int i;
+
+        for (i = 0; i < N_MESSAGE_TYPES; i++)
+                if (stats[client].sent[i].messages ||
+                    stats[client].received[i].messages)
+                        return TRUE;
+        return FALSE;
+}
+
+/******************************************************************************\
+ Print the statistics of every client slot that has seen traffic to the
+ console.
+\******************************************************************************/
+static void print_stats(void)
+{
+        stats_client_t *sc;
+        int i, j;
+
+        for (i = 0; i <= N_CLIENTS_MAX; i++) {
+                if (!client_active(i))
+                        continue;
+                sc = stats + i;
+                C_print(C_va("%s: queue max %d messages (%.1fkb), "
+                             "latency avg %d msec, max %d msec",
+                             N_client_to_string(i), sc->depth_max,
+                             sc->queued_max / 1024.f,
+                             sc->flushed ? sc->latency_total / sc->flushed : 0,
+                             sc->latency_max));
+                for (j = 0; j < N_MESSAGE_TYPES; j++) {
+                        if (sc->sent[j].messages)
+                                C_print(C_va("    sent %-20s %7u (%.1fkb)",
+                                             type_name(i, TRUE, j),
+                                             sc->sent[j].messages,
+                                             sc->sent[j].bytes / 1024.f));
+                        if (sc->received[j].messages)
+                                C_print(C_va("    recv %-20s %7u (%.1fkb)",
+                                             type_name(i, FALSE, j),
+                                             sc->received[j].messages,
+                                             sc->received[j].bytes / 1024.f));
+                }
+        }
+}
+
+/******************************************************************************\
+ Save the statistics to a CSV file. Each message type gets a row per
+ direction. Send queue statistics follow as rows of the "queue" direction,
+ with their value in the messages column.
+\******************************************************************************/
+static void save_stats(const char *filename)
+{
+        c_file_t file;
+        stats_client_t *sc;
+        int i, j;
+
+        if (!C_absolute_path(filename))
+                filename = C_va("%s/%s", C_user_dir(), filename);
+        if (!C_file_init_write(&file, filename)) {
+                C_warning("Failed to save network statistics to '%s'",
+                          filename);
+                return;
+        }
+        C_file_printf(&file, "msec,client,direction,message,messages,bytes\n");
+        for (i = 0; i <= N_CLIENTS_MAX; i++) {
+                if (!client_active(i))
+                        continue;
+                sc = stats + i;
+                for (j = 0; j < N_MESSAGE_TYPES; j++) {
+                        if (sc->sent[j].messages)
+                                C_file_printf(&file, "%d,%d,sent,%s,%u,%u\n",
+                                              c_time_msec, i,
+                                              type_name(i, TRUE, j),
+                                              sc->sent[j].messages,
+                                              sc->sent[j].bytes);
+                        if (sc->received[j].messages)
+                                C_file_printf(&file,
+                                              "%d,%d,received,%s,%u,%u\n",
+                                              c_time_msec, i,
+                                              type_name(i, FALSE, j),
+                                              sc->received[j].messages,
+                                              sc->received[j].bytes);
+                }
+                C_file_printf(&file, "%d,%d,queue,depth_max,%d,%d\n",
+                              c_time_msec, i, sc->depth_max, sc->queued_max);
+                C_file_printf(&file, "%d,%d,queue,latency_avg,%u,0\n",
+                              c_time_msec, i, sc->flushed ?
+                              sc->latency_total / sc->flushed : 0);
+                C_file_printf(&file, "%d,%d,queue,latency_max,%d,0\n",
+                              c_time_msec, i, sc->latency_max);
+        }
+        C_file_cleanup(&file);
+}
+
+/******************************************************************************\
+ Print the statistics to the console if [filename] is "-", otherwise save
+ them to the named CSV file.
+\******************************************************************************/
+void N_stats_dump(const char *filename)
+{
+        if (!filename || !filename[0])
+                return;
+        N_lock();
+        if (!strcmp(filename, "-"))
+                print_stats();
+        else
+                save_stats(filename);
+        N_unlock();
+}
+
+/******************************************************************************\
+ Called while polling the network. Saves the statistics periodically if a
+ file has been configured.
+\******************************************************************************/
+void N_stats_update(void)
+{
+        if (!n_stats_file.value.s[0] || n_stats_interval.value.n <= 0 ||
+            c_time_msec - dump_time < n_stats_interval.value.n * 1000)
+                return;
+        dump_time = c_time_msec;
+        save_stats(n_stats_file.value.s);
+}
@@ -16,8 +16,27 @@
 /* Receive function that arriving messages are routed to */
 n_callback_f n_client_func, n_server_func;
 
-static int sync_pos, sync_size;
-static char sync_buffer[N_SYNC_MAX];
+/* Message being built and how much of it has been packed */
+static n_message_t *sync_message;
+static int sync_size;
+
+/* The message being received points directly into the buffer it arrived in */
+static const char *recv_data;
+static int recv_pos, recv_size;
+
+/* Set in the size of a message frame that holds a compressed batch of
+   complete messages instead of a single message */
+#define COMPRESSED_BIT 0x8000
+
+/* Bytes that went into compressed batches and what they compressed to */
+c_count_t n_count_compressed, n_count_uncompressed;
+
+/* Number of entries a send queue starts out with */
+#define SEND_QUEUE_MIN 64
+
+/* Compression state is kept between batches */
+static z_stream deflate_stream;
+static bool deflate_inited;
 
 /******************************************************************************\
  Call these functions to retrieve an argument from the current message from
@@ -27,9 +46,9 @@ char N_receive_char(void)
 {
         char value;
 
-        if (!sync_buffer || sync_pos + 1 > sync_size)
+        if (!recv_data || recv_pos + 1 > recv_size)
                 return NUL;
-        value = sync_buffer[sync_pos++];
+        value = recv_data[recv_pos++];
         return value;
 }
 
@@ -37,10 +56,10 @@ int N_receive_int(void)
 {
         int value;
 
-        if (!sync_buffer || sync_pos + 4 > sync_size)
+        if (!recv_data || recv_pos + 4 > recv_size)
                 return 0;
-        value = (int)SDL_SwapLE32(*(Uint32 *)(sync_buffer + sync_pos));
-        sync_pos += 4;
+        value = (int)SDL_SwapLE32(*(Uint32 *)(recv_data + recv_pos));
+        recv_pos += 4;
         return value;
 }
 
@@ -59,35 +78,102 @@ short N_receive_short(void)
 {
         short value;
 
-        if (!sync_buffer || sync_pos + 2 > sync_size)
+        if (!recv_data || recv_pos + 2 > recv_size)
                 return 0;
-        value = (short)SDL_SwapLE16(*(Uint16 *)(sync_buffer + sync_pos));
-        sync_pos += 2;
+        value = (short)SDL_SwapLE16(*(Uint16 *)(recv_data + recv_pos));
+        recv_pos += 2;
         return value;
 }
 
+/******************************************************************************\
+ Receive a variable-length integer written by N_send_varint().
+\******************************************************************************/
+int N_receive_varint(void)
+{
+        unsigned int value;
+        int i, byte;
+
+        for (value = 0, i = 0; i < 5; i++) {
+                if (!recv_data || recv_pos + 1 > recv_size)
+                        return 0;
+                byte = (unsigned char)recv_data[recv_pos++];
+                value |= (unsigned int)(byte & 0x7f) << (7 * i);
+                if (!(byte & 0x80))
+                        break;
+        }
+        return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
 void N_receive_string(char *buffer, int size)
 {
         int from, len;
 
-        if (!sync_buffer || !buffer || size < 1) {
-                *buffer = NUL;
+        if (!buffer || size < 1)
                 return;
-        }
-        for (from = sync_pos; sync_buffer[sync_pos]; sync_pos++)
-                if (sync_pos > sync_size) {
-                        *buffer = NUL;
-                        return;
-                }
-        len = ++sync_pos - from;
+        *buffer = NUL;
+        if (!recv_data)
+                return;
+
+        /* The string must be terminated inside the message */
+        for (from = recv_pos; recv_pos < recv_size && recv_data[recv_pos];
+             recv_pos++);
+        if (recv_pos >= recv_size)
+                return;
+
+        /* Truncate strings that do not fit */
+        len = ++recv_pos - from;
         if (len > size)
                 len = size;
-        memmove(buffer, sync_buffer + from, len);
+        memmove(buffer, recv_data + from, len);
+        buffer[len - 1] = NUL;
+}
+
+/******************************************************************************\
+ Returns the size of the message framed at [data].
+\******************************************************************************/
+static int message_size(const char *data)
+{
+        return SDL_SwapLE16(*(Uint16 *)data) & ~COMPRESSED_BIT;
+}
+
+/******************************************************************************\
+ Returns TRUE if the frame at [data] is a compressed batch of messages.
+\******************************************************************************/
+static bool message_compressed(const char *data)
+{
+        return (SDL_SwapLE16(*(Uint16 *)data) & COMPRESSED_BIT) != 0;
 }
 
 /******************************************************************************\
- Write bytes to the data buffer. The datum is assumed to be an integer or
- float that needs byte-order rearranging.
+ Allocate a message that can hold [size] bytes. The message starts out with a
+ single reference owned by the caller.
+\******************************************************************************/
+static n_message_t *message_alloc(int size)
+{
+        n_message_t *msg;
+
+        msg = C_malloc(sizeof (*msg) + size);
+        msg->refs = 1;
+        msg->size = 0;
+        return msg;
+}
+
+/******************************************************************************\
+ Drop a reference to a message, freeing it once nobody holds one. The message
+ may also be in queues that the network thread is sending from.
+\******************************************************************************/
+static void message_release(n_message_t *msg)
+{
+        N_lock();
+        C_assert(msg->refs > 0);
+        if (--msg->refs <= 0)
+                C_free(msg);
+        N_unlock();
+}
+
+/******************************************************************************\
+ Write bytes to the message being built. The datum is assumed to be an
+ integer or float that needs byte-order rearranging.
 \******************************************************************************/
 static bool write_bytes(int offset, int bytes, void *data)
 {
@@ -95,7 +181,9 @@ static bool write_bytes(int offset, int bytes, void *data)
 
         if (offset + bytes > N_SYNC_MAX)
                 return FALSE;
-        to = sync_buffer + offset;
+        if (!sync_message)
+                N_send_start();
+        to = sync_message->data + offset;
         switch (bytes) {
         case 1:
                 *(char *)to = *(char *)data;
@@ -114,16 +202,18 @@ static bool write_bytes(int offset, int bytes, void *data)
 }
 
 /******************************************************************************\
- Reset the sync buffer. Use before sending via N_send_* calls.
+ Start building a new message. Use before sending via N_send_* calls.
 \******************************************************************************/
 void N_send_start(void)
 {
+        if (!sync_message)
+                sync_message = message_alloc(N_SYNC_MAX);
         sync_size = 2;
 }
 
 /******************************************************************************\
- Add data to the send buffer. Call N_send(client, NULL) to finish sending data.
- Returns FALSE if the buffer overflowed.
+ Add data to the message being built. Call N_send(client, NULL) to finish
+ sending data. Returns FALSE if the message overflowed.
 \******************************************************************************/
 bool N_send_char(char ch)
 {
@@ -145,41 +235,237 @@ bool N_send_float(float f)
         return write_bytes(sync_size, 4, &f);
 }
 
+/******************************************************************************\
+ Add a variable-length integer to the message being built. Small values of
+ either sign take a single byte and no value takes more than five.
+\******************************************************************************/
+bool N_send_varint(int n)
+{
+        unsigned int value;
+
+        if (!sync_message)
+                N_send_start();
+        value = ((unsigned int)n << 1) ^ (unsigned int)(n >> 31);
+        for (; value >= 0x80; value >>= 7) {
+                if (sync_size >= N_SYNC_MAX)
+                        return FALSE;
+                sync_message->data[sync_size++] = (char)(value | 0x80);
+        }
+        if (sync_size >= N_SYNC_MAX)
+                return FALSE;
+        sync_message->data[sync_size++] = (char)value;
+        return TRUE;
+}
+
+/******************************************************************************\
+ Returns the number of bytes packed into the message being sent so far.
+\******************************************************************************/
+int N_send_size(void)
+{
+        return sync_size;
+}
+
 bool N_send_string(const char *string)
 {
         int string_len;
 
+        if (!sync_message)
+                N_send_start();
         string_len = C_strlen(string) + 1;
         if (string_len <= 1) {
                 if (sync_size > N_SYNC_MAX - 1)
                         return FALSE;
-                sync_buffer[sync_size++] = NUL;
+                sync_message->data[sync_size++] = NUL;
                 return TRUE;
         }
         if (sync_size + string_len > N_SYNC_MAX)
                return FALSE;
-        memcpy(sync_buffer + sync_size, string, string_len);
+        memcpy(sync_message->data + sync_size, string, string_len);
         sync_size += string_len;
         return TRUE;
 }
 
 /******************************************************************************\
- Pack the current message buffer into the send buffers of a client.
+ Finish the message being built and take it away from the builder. The
+ message is shrunk to fit and the caller owns its only reference.
+\******************************************************************************/
+static n_message_t *message_finish(void)
+{
+        n_message_t *msg;
+
+        write_bytes(0, 2, &sync_size);
+        msg = C_realloc(sync_message, sizeof (*msg) + sync_size);
+        msg->size = sync_size;
+        msg->time = SDL_GetTicks();
+        sync_message = NULL;
+        sync_size = 0;
+        return msg;
+}
+
+/******************************************************************************\
+ Returns the message [index] places from the front of a client's send queue.
+\******************************************************************************/
+static n_message_t *queue_peek(const n_client_t *pclient, int index)
+{
+        return pclient->send_queue[(pclient->send_first + index) %
+                                   pclient->send_queue_size];
+}
+
+/******************************************************************************\
+ Add a message to the back of a client's send queue, growing the queue if it
+ is full. Takes a new reference to the message.
+\******************************************************************************/
+static void queue_push(n_client_t *pclient, n_message_t *msg)
+{
+        if (pclient->send_num >= pclient->send_queue_size) {
+                n_message_t **queue;
+                int i, size;
+
+                size = pclient->send_queue_size ?
+                       pclient->send_queue_size * 2 : SEND_QUEUE_MIN;
+                queue = C_malloc(size * sizeof (*queue));
+                for (i = 0; i < pclient->send_num; i++)
+                        queue[i] = queue_peek(pclient, i);
+                C_free(pclient->send_queue);
+                pclient->send_queue = queue;
+                pclient->send_queue_size = size;
+                pclient->send_first = 0;
+        }
+        pclient->send_queue[(pclient->send_first + pclient->send_num++) %
+                            pclient->send_queue_size] = msg;
+        pclient->send_len += msg->size;
+        msg->refs++;
+}
+
+/******************************************************************************\
+ Remove the message at the front of a client's send queue. The queue's
+ reference is handed to the caller, who must release it.
+\******************************************************************************/
+static n_message_t *queue_pop(n_client_t *pclient)
+{
+        n_message_t *msg;
+
+        C_assert(pclient->send_num > 0);
+        msg = queue_peek(pclient, 0);
+        pclient->send_len -= msg->size - pclient->send_pos;
+        pclient->send_pos = 0;
+        pclient->send_first = (pclient->send_first + 1) %
+                              pclient->send_queue_size;
+        pclient->send_num--;
+        if (pclient->send_plain > 0)
+                pclient->send_plain--;
+        return msg;
+}
+
+/******************************************************************************\
+ Discard everything in a client's send queue.
 \******************************************************************************/
-static void send_buffer(n_client_id_t client)
+void N_send_queue_clear(n_client_id_t client)
 {
+        n_client_t *pclient;
+
+        N_lock();
+        pclient = n_clients + client;
+        while (pclient->send_num > 0)
+                message_release(queue_pop(pclient));
+        pclient->send_first = 0;
+        pclient->send_len = 0;
+        pclient->backlogged = FALSE;
+        N_unlock();
+}
+
+/******************************************************************************\
+ Enable or disable compression of the messages queued for [client] from now
+ on. Only clients that have been told our protocol version can read
+ compressed batches, so compression should be enabled after the handshake.
+\******************************************************************************/
+void N_compress_client(n_client_id_t client, bool compress)
+{
+        if (n_client_id != N_HOST_CLIENT_ID || client == N_HOST_CLIENT_ID ||
+            client < 0 || client >= N_CLIENTS_MAX)
+                return;
+        N_lock();
+        n_clients[client].compress = compress;
+        n_clients[client].send_plain = n_clients[client].send_num;
+        N_unlock();
+}
+
+/******************************************************************************\
+ Clear every send queue and free the queues and compression state.
+\******************************************************************************/
+void N_cleanup_queues(void)
+{
+        int i;
+
+        for (i = 0; i <= N_CLIENTS_MAX; i++) {
+                N_send_queue_clear(i);
+                C_free(n_clients[i].send_queue);
+                n_clients[i].send_queue = NULL;
+                n_clients[i].send_queue_size = 0;
+        }
+        if (sync_message) {
+                C_free(sync_message);
+                sync_message = NULL;
+        }
+        if (deflate_inited) {
+                deflateEnd(&deflate_stream);
+                deflate_inited = FALSE;
+        }
+}
+
+/******************************************************************************\
+ Update what is waited on for a client socket. Writability is only waited for
+ while the client has queued data and readability only while its receive
+ buffer has room for another message. Only the host polls its client sockets.
+\******************************************************************************/
+void N_watch_client(n_client_id_t client)
+{
+        n_client_t *pclient;
+        int events;
+
+        if (n_client_id != N_HOST_CLIENT_ID || client == N_HOST_CLIENT_ID ||
+            client < 0 || client >= N_CLIENTS_MAX)
+                return;
+        pclient = n_clients + client;
+        if (!pclient->connected || pclient->lost)
+                return;
+        events = 0;
+        if (N_RECV_MAX - (pclient->recv_end - pclient->recv_start) >=
+            N_SYNC_MAX)
+                events |= N_POLL_READ;
+        if (pclient->send_num)
+                events |= N_POLL_WRITE;
+        N_poll_set(client, pclient->socket, events);
+}
+
+/******************************************************************************\
+ Queue a finished message for a client. The client is only dropped if the
+ queue grows past the hard limit.
+\******************************************************************************/
+static void queue_message(n_client_id_t client, n_message_t *msg)
+{
+        n_client_t *pclient;
+
         /* Overflow */
-        if (n_clients[client].buffer_len + sync_size >=
-            sizeof (n_clients[client].buffer)) {
-                C_warning("%s buffer overflow", N_client_to_string(client));
+        pclient = n_clients + client;
+        if (pclient->send_len + msg->size > n_send_max.value.n * 1024) {
+                C_warning("%s send queue overflow (%dkb)",
+                          N_client_to_string(client), pclient->send_len / 1024);
                 N_drop_client(client);
                 return;
         }
 
-        /* Pack message into the buffer */
-        memcpy(n_clients[client].buffer + n_clients[client].buffer_len,
-               sync_buffer, sync_size);
-        n_clients[client].buffer_len += sync_size;
+        queue_push(pclient, msg);
+        if (pclient->send_num == 1)
+                N_watch_client(client);
+        N_stats_queued(client, msg->data, msg->size, pclient->send_num,
+                       pclient->send_len);
+        if (!pclient->backlogged &&
+            pclient->send_len > n_send_high.value.n * 1024) {
+                pclient->backlogged = TRUE;
+                C_debug("%s is backlogged (%dkb queued)",
+                        N_client_to_string(client), pclient->send_len / 1024);
+        }
 }
 
 /******************************************************************************\
@@ -192,13 +478,14 @@ static void send_buffer(n_client_id_t client)
    f       float      4 bytes
    s       string     NULL-terminated
 
- If [client] is (-id - 1), all clients except id will receive the message. Note
- that you can either be receiving or sending. The moment you send a new
- message, the one you were receiving is lost!
+ If [client] is (-id - 1), all clients except id will receive the message.
+ The message is built once and every recipient queues a reference to it. The
+ message being received is not affected by sending.
 \******************************************************************************/
 void N_send_full(const char *file, int line, const char *func,
                  int client, const char *format, ...)
 {
+        n_message_t *msg;
         va_list va;
         int sentinel;
 
@@ -210,11 +497,11 @@ void N_send_full(const char *file, int line, const char *func,
         if (n_client_id != N_HOST_CLIENT_ID && client != N_SERVER_ID)
                 return;
 
-        /* Pack the message into the sync buffer */
+        /* Pack the message */
         if (!format || !format[0])
                 goto skip;
         va_start(va, format);
-        for (sync_size = 2; *format; format++)
+        for (N_send_start(); *format; format++)
                 switch (*format) {
                 case '1':
                 case 'c':
@@ -251,8 +538,15 @@ void N_send_full(const char *file, int line, const char *func,
                 C_error_full(file, line, func, "Missing sentinel");
         va_end(va);
 
-        /* Write the size of the message as the first 2-bytes */
-skip:   write_bytes(0, 2, &sync_size);
+        /* Write the size of the message as the first 2-bytes. We hold on to
+           our reference until every recipient has queued it, because a
+           recipient may be dropped along the way. */
+skip:   if (!sync_message) {
+                C_warning_full(file, line, func, "No message to send");
+                return;
+        }
+        msg = message_finish();
+        N_lock();
 
         /* Broadcast to every client */
         if (client == N_BROADCAST_ID || client == N_SELECTED_ID || client < 0) {
@@ -264,18 +558,20 @@ skip:   write_bytes(0, 2, &sync_size);
                         if (!n_clients[i].connected || i == except ||
                             (!n_clients[i].selected && client == N_SELECTED_ID))
                                 continue;
-                        send_buffer(i);
+                        queue_message(i, msg);
                 }
-                return;
         }
 
         /* Single-client message */
-        if (!n_clients[client].connected) {
-                C_warning("Tried to message unconnected %s",
-                          N_client_to_string(client));
-                return;
-        }
-        send_buffer(client);
+        else if (!n_clients[client].connected)
+                C_warning_full(file, line, func,
+                               "Tried to message unconnected %s",
+                               N_client_to_string(client));
+        else
+                queue_message(client, msg);
+
+        message_release(msg);
+        N_unlock();
         return;
 
 overflow:
@@ -284,14 +580,84 @@ overflow:
 }
 
 /******************************************************************************\
- Try to send buffer.
+ Replace the messages at the front of a client's send queue with a single
+ compressed batch if there are enough of them and it makes them smaller. The
+ messages are fed to zlib straight from where they are queued.
+\******************************************************************************/
+static void compress_queue(n_client_t *pclient)
+{
+        n_message_t *msg, *batch;
+        int i, len, size, ret;
+
+        /* Count the messages that fit into one batch */
+        for (len = size = 0; len < pclient->send_num; len++) {
+                msg = queue_peek(pclient, len);
+                if (message_compressed(msg->data) ||
+                    size + msg->size > N_SYNC_MAX)
+                        break;
+                size += msg->size;
+        }
+        if (n_compress.value.n <= 0 || size < n_compress.value.n)
+                return;
+
+        /* Deflate the messages into the batch */
+        if (!deflate_inited) {
+                C_zero(&deflate_stream);
+                if (deflateInit(&deflate_stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+                        return;
+                deflate_inited = TRUE;
+        } else
+                deflateReset(&deflate_stream);
+        batch = message_alloc(N_SYNC_MAX);
+        deflate_stream.next_out = (Bytef *)batch->data + 2;
+        deflate_stream.avail_out = N_SYNC_MAX - 2;
+        for (ret = Z_OK, i = 0; i < len; i++) {
+                msg = queue_peek(pclient, i);
+                deflate_stream.next_in = (Bytef *)msg->data;
+                deflate_stream.avail_in = msg->size;
+                ret = deflate(&deflate_stream, i < len - 1 ? Z_NO_FLUSH :
+                                                             Z_FINISH);
+                if (ret == Z_STREAM_ERROR || deflate_stream.avail_in)
+                        break;
+        }
+        batch->size = N_SYNC_MAX - deflate_stream.avail_out;
+        if (ret != Z_STREAM_END || batch->size >= size) {
+                C_free(batch);
+                return;
+        }
+        batch->size |= COMPRESSED_BIT;
+        *(Uint16 *)batch->data = SDL_SwapLE16((Uint16)batch->size);
+        batch->size &= ~COMPRESSED_BIT;
+        batch = C_realloc(batch, sizeof (*batch) + batch->size);
+        batch->time = queue_peek(pclient, 0)->time;
+
+        /* Swap the messages for the batch */
+        for (i = 0; i < len; i++)
+                message_release(queue_pop(pclient));
+        pclient->send_first = (pclient->send_first + pclient->send_queue_size -
+                               1) % pclient->send_queue_size;
+        pclient->send_queue[pclient->send_first] = batch;
+        pclient->send_num++;
+        pclient->send_len += batch->size;
+        C_count_add(&n_count_uncompressed, size);
+        C_count_add(&n_count_compressed, batch->size);
+}
+
+/******************************************************************************\
+ Send as much of the client's send queue as the socket will take. Several
+ queued messages are handed to the socket with each call. Returns FALSE if
+ there was an error and the client should be dropped.
 \******************************************************************************/
 bool N_send_buffer(n_client_id_t client)
 {
+        n_client_t *pclient;
+        n_message_t *msg;
         SOCKET socket;
-        int ret;
+        const char *data[N_SEND_VECTOR_MAX];
+        int i, ret, sizes[N_SEND_VECTOR_MAX], len, total;
 
-        if (!n_clients[client].connected)
+        pclient = n_clients + client;
+        if (!pclient->connected)
                 return TRUE;
 
         /* Local messages don't need to be sent */
@@ -299,26 +665,113 @@ bool N_send_buffer(n_client_id_t client)
             (client == N_HOST_CLIENT_ID || client == N_SERVER_ID))
                 return TRUE;
 
-        /* Send TCP/IP message */
+        /* Send TCP/IP messages, stopping at the first partial write */
         socket = N_client_to_socket(client);
-        ret = N_socket_send(socket, n_clients[client].buffer,
-                            n_clients[client].buffer_len);
-        if (ret > 0)
-                n_clients[client].buffer_len = 0;
-        else if (ret < 0)
+        while (pclient->send_num > 0) {
+                if (pclient->compress && !pclient->send_pos &&
+                    !pclient->send_plain)
+                        compress_queue(pclient);
+
+                /* Gather as many messages as the socket will take at once */
+                for (total = len = 0; len < pclient->send_num &&
+                                      len < N_SEND_VECTOR_MAX; len++) {
+                        msg = queue_peek(pclient, len);
+                        data[len] = msg->data;
+                        sizes[len] = msg->size;
+                        if (!len) {
+                                data[len] += pclient->send_pos;
+                                sizes[len] -= pclient->send_pos;
+                        }
+                        total += sizes[len];
+                }
+                if ((ret = N_socket_send_vector(socket, data, sizes, len)) < 0)
+                        return FALSE;
+
+                /* Release the messages that were sent completely */
+                for (i = 0; i < len && ret >= sizes[i]; i++) {
+                        ret -= sizes[i];
+                        msg = queue_pop(pclient);
+                        N_stats_flushed(client, SDL_GetTicks() - msg->time);
+                        message_release(msg);
+                }
+                if (i < len) {
+                        pclient->send_pos += ret;
+                        pclient->send_len -= ret;
+                        break;
+                }
+        }
+        if (!pclient->send_num)
+                N_watch_client(client);
+
+        /* Resume sending deferred updates once the queue has drained */
+        if (pclient->backlogged &&
+            pclient->send_len <= n_send_low.value.n * 1024) {
+                pclient->backlogged = FALSE;
+                if (!N_thread_self())
+                        C_debug("%s is no longer backlogged",
+                                N_client_to_string(client));
+        }
+        return TRUE;
+}
+
+/******************************************************************************\
+ Dispatch a message of [size] bytes at [data] to the message handler.
+\******************************************************************************/
+static void dispatch(n_client_id_t client, n_callback_f callback,
+                     const char *data, int size)
+{
+        N_stats_received(client, data, size);
+        recv_data = data;
+        recv_pos = 2;
+        recv_size = size;
+        callback(client, N_EV_MESSAGE);
+        recv_data = NULL;
+}
+
+/******************************************************************************\
+ Decompress a batch of messages and dispatch each of them. Returns FALSE if
+ the batch is corrupt and the connection should be dropped.
+\******************************************************************************/
+static bool receive_compressed(n_client_id_t client, n_callback_f callback,
+                               const char *data, int size)
+{
+        static char buffer[N_SYNC_MAX];
+        uLongf len;
+        int pos, message;
+
+        len = sizeof (buffer);
+        if (uncompress((Bytef *)buffer, &len, (const Bytef *)data + 2,
+                       size - 2) != Z_OK) {
+                C_warning("Invalid compressed batch (%s)",
+                          N_client_to_string(client));
                 return FALSE;
+        }
+        C_count_add(&n_count_compressed, size);
+        C_count_add(&n_count_uncompressed, (int)len);
+        for (pos = 0; pos < (int)len; pos += message) {
+                if ((int)len - pos < 2 || message_compressed(buffer + pos) ||
+                    (message = message_size(buffer + pos)) < 2 ||
+                    message > (int)len - pos) {
+                        C_warning("Invalid message in compressed batch (%s)",
+                                  N_client_to_string(client));
+                        return FALSE;
+                }
+                dispatch(client, callback, buffer + pos, message);
+                if (!n_clients[client].connected)
+                        break;
+        }
         return TRUE;
 }
 
 /******************************************************************************\
- Receive local messages directly from the send buffers. Returns TRUE if
+ Receive local messages directly from the send queues. Returns TRUE if
  [client] was local.
 \******************************************************************************/
 static bool receive_local(n_client_id_t client)
 {
         n_client_t *pclient;
         n_callback_f callback;
-        int pos;
+        n_message_t *msg;
 
         if (n_client_id != N_HOST_CLIENT_ID)
                 return FALSE;
@@ -333,85 +786,131 @@ static bool receive_local(n_client_id_t client)
         } else
                 return FALSE;
 
-        /* Dispatch messages in order */
-        for (pos = 0; pos < pclient->buffer_len; ) {
-                sync_pos = 0;
-
-                /* Unpack the message size */
-                sync_buffer[0] = pclient->buffer[pos];
-                sync_buffer[1] = pclient->buffer[pos + 1];
-                sync_size = N_receive_short();
-                C_assert(sync_size <= pclient->buffer_len - pos);
-
-                /* Copy the entire message into the sync buffer */
-                memcpy(sync_buffer, pclient->buffer + pos, sync_size);
-                pos += sync_size;
-                callback(client, N_EV_MESSAGE);
+        /* Dispatch messages in order. Handlers may queue more messages as we
+           go or clear the queue entirely, so each message is taken off the
+           queue before it is handled. */
+        while (pclient->send_num > 0) {
+                msg = queue_pop(pclient);
+                dispatch(client, callback, msg->data, msg->size);
+                message_release(msg);
         }
-        pclient->buffer_len = 0;
         return TRUE;
 }
 
 /******************************************************************************\
- Receive data from a socket. Returns FALSE if an error occured and the
- connection should be dropped.
+ Read from a client's socket into its receive buffer, moving the trailing
+ partial message to the front first if that makes room for a complete
+ message. Returns 1 if the buffer was filled and there may be more to read, 0
+ if the socket has been drained or there is no room and -1 if the connection
+ was closed or failed. The error is returned in [error] if there was one.
 \******************************************************************************/
-bool N_receive(n_client_id_t client)
+int N_receive_socket(n_client_id_t client, const char **error)
 {
-        SOCKET socket;
-        int len, message_size;
+        n_client_t *pclient;
+        int len, space;
+
+        /* Move the partial message to the front to make room */
+        pclient = n_clients + client;
+        *error = NULL;
+        if (pclient->recv_start >= pclient->recv_end)
+                pclient->recv_start = pclient->recv_end = 0;
+        else if (N_RECV_MAX - pclient->recv_end < N_SYNC_MAX) {
+                memmove(pclient->recv_buffer,
+                        pclient->recv_buffer + pclient->recv_start,
+                        pclient->recv_end - pclient->recv_start);
+                pclient->recv_end -= pclient->recv_start;
+                pclient->recv_start = 0;
+        }
 
-        /* Receive from the local queue */
-        if (!n_clients[client].connected || receive_local(client))
-                return TRUE;
+        /* Complete messages have not been dispatched yet */
+        space = N_RECV_MAX - pclient->recv_end;
+        if (space < N_SYNC_MAX)
+                return 0;
 
-        /* Receive from a socket */
-        for (socket = N_client_to_socket(client); ; ) {
-                const char *error;
+        /* Read as much as will fit */
+        len = (int)recv(N_client_to_socket(client),
+                        pclient->recv_buffer + pclient->recv_end, space, 0);
 
-                /* Receive the message size */
-                len = (int)recv(socket, sync_buffer, N_SYNC_MAX, MSG_PEEK);
+        /* Orderly shutdown */
+        if (!len)
+                return -1;
 
-                /* Orderly shutdown */
-                if (!len)
-                        return FALSE;
+        /* Error */
+        if ((*error = N_socket_error(len)))
+                return -1;
+
+        /* No data */
+        if (len < 0)
+                return 0;
+        pclient->recv_end += len;
+        return len < space ? 0 : 1;
+}
 
-                /* Error */
-                if ((error = N_socket_error(len))) {
-                        C_debug("Error receiving from %s: %s",
-                                N_client_to_string(client), error);
+/******************************************************************************\
+ Dispatch every complete message in a client's receive buffer from where it
+ landed. Returns FALSE if an invalid message was received and the connection
+ should be dropped.
+\******************************************************************************/
+bool N_receive_buffered(n_client_id_t client)
+{
+        n_client_t *pclient;
+        n_callback_f callback;
+        const char *data;
+        int size;
+
+        pclient = n_clients + client;
+        callback = n_client_id == N_HOST_CLIENT_ID ? n_server_func :
+                                                     n_client_func;
+        while (pclient->connected &&
+               pclient->recv_end - pclient->recv_start >= 2) {
+                data = pclient->recv_buffer + pclient->recv_start;
+                size = message_size(data);
+                if (size < 2 || size > N_SYNC_MAX) {
+                        C_warning("Invalid message size %d (%s)",
+                                  size, N_client_to_string(client));
                         return FALSE;
                 }
+                if (pclient->recv_end - pclient->recv_start < size)
+                        break;
+                pclient->recv_start += size;
+                if (!message_compressed(data))
+                        dispatch(client, callback, data, size);
+                else if (!receive_compressed(client, callback, data, size))
+                        return FALSE;
+        }
+        return TRUE;
+}
 
-                /* Did not receive the message size */
-                if (len < 2)
-                        return TRUE;
+/******************************************************************************\
+ Receive data from a socket. Data is read into the client's receive buffer
+ with as few calls as possible and complete messages are dispatched from
+ where they landed. Only the trailing partial message is ever moved. Returns
+ FALSE if an error occured and the connection should be dropped.
+\******************************************************************************/
+bool N_receive(n_client_id_t client)
+{
+        n_client_t *pclient;
+        const char *error;
+        int ret;
 
-                /* Read the message length */
-                sync_pos = 0;
-                sync_size = 2;
-                message_size = N_receive_short();
-                if (message_size < 1 || message_size > N_SYNC_MAX) {
-                        C_warning("Invalid message size %d "
-                                  "(recv returned %d, %s)", message_size, len,
-                                  N_client_to_string(client));
+        /* Receive from the local queue */
+        pclient = n_clients + client;
+        if (!pclient->connected || receive_local(client))
+                return TRUE;
+
+        /* Receive from a socket */
+        for (;;) {
+                if ((ret = N_receive_socket(client, &error)) < 0) {
+                        if (error)
+                                C_debug("Error receiving from %s: %s",
+                                        N_client_to_string(client), error);
                         return FALSE;
                 }
+                if (!N_receive_buffered(client))
+                        return FALSE;
 
-                /* Check if we have enough room now */
-                if (len < message_size)
+                /* The handler may have dropped the connection */
+                if (!pclient->connected || !ret)
                         return TRUE;
-
-                /* Read the entire message */
-                recv(socket, sync_buffer, message_size, 0);
-
-                /* Dispatch the message */
-                sync_pos = 2;
-                sync_size = message_size;
-                if (n_client_id == N_HOST_CLIENT_ID)
-                        n_server_func(client, N_EV_MESSAGE);
-                else
-                        n_client_func(N_SERVER_ID, N_EV_MESSAGE);
         }
 }
-
@@ -0,0 +1,238 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* While hosting, the client sockets are serviced on a thread of their own so
+   that queued messages keep going out and incoming messages keep being read
+   while the main thread is busy rendering or loading. Messages are still built
+   and dispatched on the main thread. The client tables are shared under a
+   single lock that the network functions take for themselves. The thread
+   never calls back into the game and never logs, because the log handler can
+   draw to the console. */
+
+#include "n_common.h"
+
+/* Longest the network thread sleeps before noticing it should stop. With
+   poll() and select() this is also how long it takes to notice sockets that
+   started or stopped being watched. */
+#define THREAD_WAIT_MSEC 10
+
+static SDL_Thread *thread;
+static SDL_mutex *lock;
+static SDL_cond *activity_cond;
+static Uint32 main_id;
+static int lock_depth;
+static bool activity, pending_listen, pending_http;
+
+/* Only changed by the main thread while the network thread is not running,
+   except [stopping], which is only touched with the lock held */
+static bool running, stopping;
+
+/******************************************************************************\
+ Take or release the network lock. The lock is recursive so that message
+ handlers can send messages while their message is being dispatched. Does
+ nothing until the thread has been started once.
+\******************************************************************************/
+void N_lock(void)
+{
+        if (!lock)
+                return;
+        SDL_mutexP(lock);
+        if (!N_thread_self())
+                lock_depth++;
+}
+
+void N_unlock(void)
+{
+        if (!lock)
+                return;
+        if (!N_thread_self()) {
+                if (lock_depth < 1)
+                        return;
+                lock_depth--;
+        }
+        SDL_mutexV(lock);
+}
+
+/******************************************************************************\
+ Returns TRUE if the network thread is running.
+\******************************************************************************/
+bool N_thread_running(void)
+{
+        return running;
+}
+
+/******************************************************************************\
+ Returns TRUE if called from the network thread.
+\******************************************************************************/
+bool N_thread_self(void)
+{
+        return running && SDL_ThreadID() != main_id;
+}
+
+/******************************************************************************\
+ Send and receive whatever a ready client socket allows. Received data is only
+ buffered. A client whose connection failed is marked [lost] for the main
+ thread to drop.
+\******************************************************************************/
+static void service_client(n_client_id_t client, int events)
+{
+        n_client_t *pclient;
+        const char *error;
+        int ret;
+
+        pclient = n_clients + client;
+        if (client >= N_CLIENTS_MAX || !pclient->connected || pclient->lost)
+                return;
+        ret = 0;
+        if ((events & N_POLL_WRITE) && !N_send_buffer(client))
+                ret = -1;
+        if (ret >= 0 && (events & N_POLL_READ)) {
+                while ((ret = N_receive_socket(client, &error)) > 0);
+                activity = TRUE;
+        }
+        if (ret < 0) {
+                pclient->lost = TRUE;
+                N_poll_set(client, INVALID_SOCKET, 0);
+                activity = TRUE;
+                return;
+        }
+        N_watch_client(client);
+}
+
+/******************************************************************************\
+ The network thread's loop. The listen and HTTP sockets are handed over to
+ the main thread when they become ready and are not watched again until it
+ has serviced them.
+\******************************************************************************/
+static int thread_main(void *unused)
+{
+        const n_poll_event_t *events;
+        int i, len, tag;
+
+        for (;;) {
+                events = N_poll_wait(THREAD_WAIT_MSEC, &len);
+                N_lock();
+                if (stopping) {
+                        N_unlock();
+                        break;
+                }
+                for (i = 0; i < len; i++) {
+                        tag = events[i].tag;
+                        if (tag == N_POLL_LISTEN || tag == N_POLL_HTTP) {
+                                N_poll_set(tag, INVALID_SOCKET, 0);
+                                if (tag == N_POLL_LISTEN)
+                                        pending_listen = TRUE;
+                                else
+                                        pending_http = TRUE;
+                                activity = TRUE;
+                                continue;
+                        }
+                        service_client(tag, events[i].events);
+                }
+                if (activity)
+                        SDL_CondSignal(activity_cond);
+                N_unlock();
+        }
+        return 0;
+}
+
+/******************************************************************************\
+ Start servicing client sockets on the network thread.
+\******************************************************************************/
+void N_thread_start(void)
+{
+        if (thread)
+                return;
+        C_var_unlatch(&n_thread);
+        if (!n_thread.value.n)
+                return;
+
+        /* Memory checking keeps its own unlocked bookkeeping */
+        if (c_mem_check.value.n) {
+                C_debug("Memory checking enabled, not starting network thread");
+                return;
+        }
+
+        if (!lock) {
+                lock = SDL_CreateMutex();
+                activity_cond = SDL_CreateCond();
+                if (!lock || !activity_cond) {
+                        C_warning("Failed to create network lock: %s",
+                                  SDL_GetError());
+                        return;
+                }
+        }
+        main_id = SDL_ThreadID();
+        running = TRUE;
+        stopping = FALSE;
+        activity = pending_listen = pending_http = FALSE;
+        if (!(thread = SDL_CreateThread(thread_main, NULL))) {
+                running = FALSE;
+                C_warning("Failed to start network thread: %s",
+                          SDL_GetError());
+                return;
+        }
+        C_debug("Started network thread");
+}
+
+/******************************************************************************\
+ Stop the network thread and wait for it to exit. The main thread may be
+ holding the lock, so it is let go of entirely until the thread is gone.
+\******************************************************************************/
+void N_thread_stop(void)
+{
+        int i, depth;
+
+        if (!thread)
+                return;
+        N_lock();
+        stopping = TRUE;
+        N_unlock();
+        depth = lock_depth;
+        for (i = 0; i < depth; i++)
+                N_unlock();
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+        running = FALSE;
+        for (i = 0; i < depth; i++)
+                N_lock();
+        C_debug("Stopped network thread");
+}
+
+/******************************************************************************\
+ Stop the network thread and free the lock.
+\******************************************************************************/
+void N_thread_cleanup(void)
+{
+        N_thread_stop();
+        if (!lock || lock_depth)
+                return;
+        SDL_DestroyCond(activity_cond);
+        SDL_DestroyMutex(lock);
+        activity_cond = NULL;
+        lock = NULL;
+}
+
+/******************************************************************************\
+ Called on the main thread with the lock held. Waits up to [msec]
+ milliseconds for the network thread to receive something unless it already
+ has. Returns which of the listen and HTTP sockets were handed over in
+ [listen] and [http].
+\******************************************************************************/
+void N_thread_wait(int msec, bool *listen, bool *http)
+{
+        if (msec > 0 && !activity)
+                SDL_CondWaitTimeout(activity_cond, lock, msec);
+        *listen = pending_listen;
+        *http = pending_http;
+        activity = pending_listen = pending_http = FALSE;
+}
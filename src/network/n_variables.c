@@ -14,11 +14,70 @@
 
 c_var_t n_port;
 
+/* Send queue watermarks */
+c_var_t n_send_high, n_send_low, n_send_max;
+
+/* Stream compression */
+c_var_t n_compress;
+
+/* Network thread */
+c_var_t n_thread;
+
+/* Traffic statistics */
+c_var_t n_stats, n_stats_file, n_stats_interval;
+
+/******************************************************************************\
+ Prints or saves the network statistics when the variable is set. The value is
+ never set so the same command can be repeated.
+\******************************************************************************/
+static int stats_update(c_var_t *var, c_var_value_t value)
+{
+        N_stats_dump(value.s);
+        return FALSE;
+}
+
 /******************************************************************************\
  Registers the network namespace variables.
 \******************************************************************************/
 void N_register_variables(void)
 {
         C_register_integer(&n_port, "n_port", 32500, "server port");
+
+        /* Send queue watermarks */
+        C_register_integer(&n_send_high, "n_send_high", 256,
+                           "defer updates to clients with this many kb queued");
+        n_send_high.edit = C_VE_ANYTIME;
+        C_register_integer(&n_send_low, "n_send_low", 64,
+                           "resume updates when queue drains to this many kb");
+        n_send_low.edit = C_VE_ANYTIME;
+        C_register_integer(&n_send_max, "n_send_max", 16384,
+                           "drop clients with this many kb queued");
+        n_send_max.edit = C_VE_ANYTIME;
+
+        /* Stream compression */
+        C_register_integer(&n_compress, "n_compress", 512,
+                           "compress queued messages to clients once this "
+                           "many bytes are waiting, 0 disables");
+        n_compress.edit = C_VE_ANYTIME;
+
+        /* Network thread */
+        C_register_integer(&n_thread, "n_thread", TRUE,
+                           "send to and receive from clients on a separate "
+                           "thread while hosting");
+
+        /* Traffic statistics */
+        C_register_string(&n_stats, "n_stats", "",
+                          "print network statistics with '-' or save them "
+                          "to this CSV file");
+        n_stats.archive = FALSE;
+        n_stats.edit = C_VE_FUNCTION;
+        n_stats.update = stats_update;
+        C_register_string(&n_stats_file, "n_stats_file", "",
+                          "periodically save network statistics to this CSV "
+                          "file");
+        n_stats_file.edit = C_VE_ANYTIME;
+        C_register_integer(&n_stats_interval, "n_stats_interval", 60,
+                           "seconds between saves of network statistics");
+        n_stats_interval.edit = C_VE_ANYTIME;
 }
 
@@ -37,34 +37,49 @@ static void render_status(void)
                 if (c_throttle_msec > 0)
                         str = C_va(PACKAGE_STRING
                                    ": %.0f fps (%.0f%% throttled), "
-                                   "%.0f faces/frame",
+                                   "%.0f faces/frame, %.0fkb frame memory",
                                    C_count_fps(&c_throttled),
                                    100.f * C_count_per_frame(&c_throttled) /
                                            c_throttle_msec,
-                                   C_count_per_frame(&r_count_faces));
+                                   C_count_per_frame(&r_count_faces),
+                                   c_frame_mem_high / 1024.f);
                 else
                         str = C_va(PACKAGE_STRING
-                                   ": %.0f fps, %.0f faces/frame",
+                                   ": %.0f fps, %.0f faces/frame, "
+                                   "%.0fkb frame memory",
                                    C_count_fps(&c_throttled),
-                                   C_count_per_frame(&r_count_faces));
+                                   C_count_per_frame(&r_count_faces),
+                                   c_frame_mem_high / 1024.f);
                 R_text_configure(&status_text, R_FONT_CONSOLE,
                                  0, 1.f, FALSE, str);
                 status_text.sprite.origin = C_vec2(4.f, 4.f);
                 C_count_reset(&c_throttled);
                 C_count_reset(&r_count_faces);
+                c_frame_mem_high = 0;
         }
         R_text_render(&status_text);
 }
 
 /******************************************************************************\
  This is the client's graphical main loop.
+ TODO: Run host ticks on a thread of their own. Ticks load ship and building
+       models and raise popups, which would have to be queued for this
+       thread, and rendering would have to read ship state from a copy.
 \******************************************************************************/
 static void main_loop(void)
 {
         static int corrupt_check = CORRUPT_CHECK_VALUE;
         SDL_Event ev;
+        float lerp;
+        int tick_msec;
 
         C_status("Main loop");
+        C_var_unlatch(&g_tick_rate);
+        if (g_tick_rate.value.n < 1)
+                g_tick_rate.value.n = 1;
+        if (g_tick_rate.value.n > 1000)
+                g_tick_rate.value.n = 1000;
+        tick_msec = 1000 / g_tick_rate.value.n;
         C_time_init();
         C_rand_seed((unsigned int)time(NULL));
         R_text_init(&status_text);
@@ -82,9 +97,17 @@ static void main_loop(void)
                 C_time_update();
                 C_throttle_fps();
 
-                /* Update the game after rendering everything */
-                G_update_host();
+                /* Update the game after rendering everything. Network traffic
+                   is handled every frame, but the game is advanced in fixed
+                   ticks no matter how long frames take and the ships are
+                   placed between ticks for the next frame. */
                 G_update_client();
+                while (C_time_tick(tick_msec, &lerp))
+                        G_update_tick();
+                G_interpolate_ships(lerp);
+
+                /* Transient memory is freed after every frame */
+                C_frame_reset();
 
                 /* This check is a long-shot, but if there was rampant memory
                    corruption this variable's value may have been changed */
@@ -151,6 +174,7 @@ static void cleanup(void)
         SDL_Quit();
         C_cleanup_lang();
         C_check_leaks();
+        C_dump_mem_sites(NULL);
         C_debug("Done");
 }
 
@@ -227,6 +251,11 @@ int main(int argc, char *argv[])
         G_init();
         I_init();
         R_load_test_assets();
+
+        /* In batch mode, compile the listed models and quit */
+        if (R_compile_models())
+                return 0;
+
         G_refresh_servers();
 
         /* Run the main loop */
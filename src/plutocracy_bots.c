@@ -0,0 +1,446 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* This file forms the starting point for the bot client program, which puts
+   a server under load. Every bot is a separate connection to the server from
+   this one process. Bots join a nation and then order their ships around,
+   trade and chat at configurable rates while the time the server takes to
+   answer their orders is measured. */
+
+/* Bots only need the game's message tokens, but those are internal to the
+   game namespace. The game header includes the common and network headers. */
+#include "game/g_common.h"
+
+/* Milliseconds to wait on the network between bot updates */
+#define POLL_MSEC 10
+
+/* Orders the server has not answered in this many milliseconds are counted
+   as unanswered. Ships cannot sail to every tile, so not every order gets a
+   new path. */
+#define ANSWER_TIMEOUT 5000
+
+/* State of one bot client, indexed by the slot its connection uses. The ship
+   tables are sized by the server's ship limit. */
+typedef struct bot {
+        int id, tiles, *ships, ships_len, ships_max, connect_time,
+            *move_times, next_move, next_buy, next_prices, next_chat;
+        bool connected, joined;
+} bot_t;
+
+static bot_t bots[N_CLIENTS_MAX];
+
+/* Configuration */
+static c_var_t bot_buys, bot_chats, bot_count, bot_moves, bot_prices,
+               bot_report, bot_server, bot_time;
+
+/* Response times */
+static int answers, answer_msec, answer_max, unanswered, joins, join_msec;
+
+/******************************************************************************\
+ Registers the variables that configure the bots.
+\******************************************************************************/
+static void register_variables(void)
+{
+        C_register_integer(&bot_count, "bot_count", 8,
+                           "number of bot clients to connect");
+        C_register_string(&bot_server, "bot_server", "localhost",
+                          "address of the server to put under load");
+        C_register_integer(&bot_time, "bot_time", 60,
+                           "seconds to run before quitting, 0 runs until "
+                           "killed");
+        C_register_integer(&bot_report, "bot_report", 10,
+                           "seconds between response time reports");
+        bot_report.edit = C_VE_ANYTIME;
+
+        /* Message rates */
+        C_register_integer(&bot_moves, "bot_moves", 30,
+                           "ship move orders each bot sends per minute");
+        bot_moves.edit = C_VE_ANYTIME;
+        C_register_integer(&bot_buys, "bot_buys", 6,
+                           "purchase attempts each bot makes per minute");
+        bot_buys.edit = C_VE_ANYTIME;
+        C_register_integer(&bot_prices, "bot_prices", 6,
+                           "price changes each bot makes per minute");
+        bot_prices.edit = C_VE_ANYTIME;
+        C_register_integer(&bot_chats, "bot_chats", 2,
+                           "chat messages each bot sends per minute");
+        bot_chats.edit = C_VE_ANYTIME;
+}
+
+/******************************************************************************\
+ Returns the time of the next action that happens [rate] times a minute on
+ average, or -1 if the action is disabled.
+\******************************************************************************/
+static int next_action(int rate)
+{
+        if (rate <= 0)
+                return -1;
+        return c_time_msec + (int)(60000.f / rate * (0.5f + C_rand_real()));
+}
+
+/******************************************************************************\
+ Remove [ship] from a bot's list of ships if it is there.
+\******************************************************************************/
+static void bot_remove_ship(bot_t *bot, int ship)
+{
+        int i;
+
+        for (i = 0; i < bot->ships_len; i++)
+                if (bot->ships[i] == ship) {
+                        bot->ships[i] = bot->ships[--bot->ships_len];
+                        return;
+                }
+}
+
+/******************************************************************************\
+ Free a bot's ship tables.
+\******************************************************************************/
+static void bot_free(bot_t *bot)
+{
+        C_free(bot->ships);
+        C_free(bot->move_times);
+        bot->ships = bot->move_times = NULL;
+        bot->ships_len = 0;
+}
+
+/******************************************************************************\
+ A ship changed owners. Bots keep track of the ships they own.
+\******************************************************************************/
+static void bot_ship_owner(bot_t *bot, int ship, int client)
+{
+        if (ship < 0 || ship >= bot->ships_max)
+                return;
+        bot_remove_ship(bot, ship);
+        bot->move_times[ship] = 0;
+        if (client == bot->id)
+                bot->ships[bot->ships_len++] = ship;
+}
+
+/******************************************************************************\
+ The server sent a ship's path. If the bot ordered the ship to move, this is
+ the answer.
+\******************************************************************************/
+static void bot_ship_path(bot_t *bot, int ship)
+{
+        int msec;
+
+        if (ship < 0 || ship >= bot->ships_max || !bot->move_times[ship])
+                return;
+        msec = c_time_msec - bot->move_times[ship];
+        bot->move_times[ship] = 0;
+        answers++;
+        answer_msec += msec;
+        if (msec > answer_max)
+                answer_max = msec;
+}
+
+/******************************************************************************\
+ The server sent the game info. The bot now knows its client ID and joins a
+ nation to get a ship.
+\******************************************************************************/
+static void bot_init(n_client_id_t client, bot_t *bot)
+{
+        int protocol, subdiv4;
+
+        if ((protocol = N_receive_short()) != G_PROTOCOL) {
+                C_warning("Server protocol (%d) not equal to bot (%d)",
+                          protocol, G_PROTOCOL);
+                N_drop_client(client);
+                return;
+        }
+        bot->id = N_receive_char();
+        N_receive_char();
+        if ((bot->ships_max = N_receive_short()) < 1) {
+                bot->ships_max = 0;
+                N_drop_client(client);
+                return;
+        }
+        bot_free(bot);
+        bot->ships = C_calloc(bot->ships_max * sizeof (*bot->ships));
+        bot->move_times = C_calloc(bot->ships_max * sizeof (*bot->move_times));
+        bot->ships_len = 0;
+        subdiv4 = N_receive_char();
+        bot->tiles = 20 << (2 * subdiv4);
+        if (bot->tiles > R_TILES_MAX || bot->tiles < 20)
+                bot->tiles = R_TILES_MAX;
+        bot->joined = TRUE;
+        joins++;
+        join_msec += c_time_msec - bot->connect_time;
+        N_send(client, "11", G_CM_AFFILIATE, G_NN_RED + client % 3);
+
+        /* Spread the bots' actions out */
+        bot->next_move = next_action(bot_moves.value.n);
+        bot->next_buy = next_action(bot_buys.value.n);
+        bot->next_prices = next_action(bot_prices.value.n);
+        bot->next_chat = next_action(bot_chats.value.n);
+}
+
+/******************************************************************************\
+ Called by the network namespace for every event on a bot's connection.
+ Only the messages a bot acts on are read.
+\******************************************************************************/
+static void bot_callback(int client, n_event_t event)
+{
+        bot_t *bot;
+        int ship, owner;
+
+        if (client < 0 || client >= N_CLIENTS_MAX)
+                return;
+        bot = bots + client;
+        if (event == N_EV_CONNECTED) {
+                bot_free(bot);
+                C_zero(bot);
+                bot->id = -1;
+                bot->connected = TRUE;
+                bot->connect_time = c_time_msec;
+                N_send(client, "1s", G_CM_NAME, C_va("Bot %d", client));
+                return;
+        }
+        if (event == N_EV_DISCONNECTED) {
+                if (bot->connected)
+                        C_warning("Bot %d was disconnected", client);
+                bot->connected = FALSE;
+                return;
+        }
+        if (event != N_EV_MESSAGE)
+                return;
+        switch (N_receive_char()) {
+        case G_SM_INIT:
+                bot_init(client, bot);
+                break;
+        case G_SM_SHIP_SPAWN:
+                ship = N_receive_short();
+                owner = N_receive_char();
+                bot_ship_owner(bot, ship, owner);
+                break;
+        case G_SM_SHIP_OWNER:
+                ship = N_receive_short();
+                owner = N_receive_char();
+                bot_ship_owner(bot, ship, owner);
+                break;
+        case G_SM_SHIP_PATH:
+                bot_ship_path(bot, N_receive_short());
+                break;
+        default:
+                break;
+        }
+}
+
+/******************************************************************************\
+ Send whatever orders a bot has due.
+\******************************************************************************/
+static void bot_update(n_client_id_t client, bot_t *bot)
+{
+        int ship;
+
+        if (!bot->joined || !bot->ships_len)
+                return;
+        ship = bot->ships[C_rand() % bot->ships_len];
+
+        /* Sail somewhere. Only one order per ship is timed at once. */
+        if (bot->next_move >= 0 && c_time_msec >= bot->next_move) {
+                bot->next_move = next_action(bot_moves.value.n);
+                if (bot->move_times[ship] &&
+                    c_time_msec - bot->move_times[ship] > ANSWER_TIMEOUT) {
+                        bot->move_times[ship] = 0;
+                        unanswered++;
+                }
+                if (!bot->move_times[ship])
+                        bot->move_times[ship] = c_time_msec;
+                N_send(client, "122", G_CM_SHIP_MOVE, ship,
+                       C_rand() % bot->tiles);
+        }
+
+        /* Try to buy from whoever is on a random tile. Most attempts are
+           rejected by the server, which still has to check them. */
+        if (bot->next_buy >= 0 && c_time_msec >= bot->next_buy) {
+                bot->next_buy = next_action(bot_buys.value.n);
+                N_send(client, "12212", G_CM_SHIP_BUY, ship,
+                       C_rand() % bot->tiles, G_CT_RATIONS + C_rand() %
+                       (G_CARGO_TYPES - G_CT_RATIONS), 1 + C_rand() % 10);
+        }
+
+        /* Change the prices of some cargo */
+        if (bot->next_prices >= 0 && c_time_msec >= bot->next_prices) {
+                bot->next_prices = next_action(bot_prices.value.n);
+                N_send(client, "1212222", G_CM_SHIP_PRICES, ship,
+                       G_CT_RATIONS + C_rand() % (G_CARGO_TYPES -
+                                                  G_CT_RATIONS),
+                       10 + C_rand() % 40, 20 + C_rand() % 40, 0, 100);
+        }
+
+        /* Say something */
+        if (bot->next_chat >= 0 && c_time_msec >= bot->next_chat) {
+                bot->next_chat = next_action(bot_chats.value.n);
+                N_send(client, "1s", G_CM_CHAT,
+                       C_va("Bot %d has %d ships", client, bot->ships_len));
+        }
+}
+
+/******************************************************************************\
+ Log how quickly the server has been answering and reset the counts.
+\******************************************************************************/
+static void report(void)
+{
+        int i, connected;
+
+        for (connected = i = 0; i < N_CLIENTS_MAX; i++)
+                if (bots[i].connected)
+                        connected++;
+        C_debug("%d bots connected, joined in %d msec, %d orders answered "
+                "in %d msec (max %d msec), %d unanswered", connected,
+                joins ? join_msec / joins : 0, answers,
+                answers ? answer_msec / answers : 0, answer_max, unanswered);
+        answers = answer_msec = answer_max = unanswered = 0;
+}
+
+/******************************************************************************\
+ This is the bot program's main loop. Bots are connected one at a time and
+ then updated between waits on the network.
+\******************************************************************************/
+static void main_loop(void)
+{
+        c_count_t report_count;
+        int i, end_time;
+
+        C_status("Main loop");
+        C_var_unlatch(&bot_count);
+        C_var_unlatch(&bot_server);
+        C_var_unlatch(&bot_time);
+        N_start_bots(bot_callback);
+        for (i = 0; i < bot_count.value.n; i++)
+                if (N_connect_bot(bot_server.value.s) == N_INVALID_ID)
+                        break;
+        C_debug("Connected %d bots to '%s'", i, bot_server.value.s);
+
+        C_rand_seed((unsigned int)time(NULL));
+        C_count_reset(&report_count);
+        end_time = bot_time.value.n > 0 ?
+                   c_time_msec + bot_time.value.n * 1000 : -1;
+        while (!c_exit && n_clients_num > 0) {
+                N_poll_server_wait(POLL_MSEC);
+                C_time_update();
+                for (i = 0; i < N_CLIENTS_MAX; i++)
+                        if (bots[i].connected)
+                                bot_update(i, bots + i);
+                if (bot_report.value.n > 0 &&
+                    C_count_poll(&report_count, bot_report.value.n * 1000))
+                        report();
+                if (end_time >= 0 && c_time_msec >= end_time)
+                        break;
+                C_frame_reset();
+        }
+        report();
+}
+
+/******************************************************************************\
+ Concatenates an argument array and runs it through the config parser.
+\******************************************************************************/
+static void parse_config_args(int argc, char *argv[])
+{
+        int i, len;
+        char buffer[4096], *pos;
+
+        if (argc < 2)
+                return;
+        C_status("Parsing command line");
+        buffer[0] = NUL;
+        pos = buffer;
+        for (i = 1; i < argc; i++) {
+                len = C_strlen(argv[i]);
+                if (pos + len >= buffer + sizeof (buffer)) {
+                        C_warning("Command-line config overflowed");
+                        return;
+                }
+                memcpy(pos, argv[i], len);
+                pos += len;
+                *(pos++) = ' ';
+        }
+        *pos = NUL;
+        C_parse_config_string(buffer);
+}
+
+/******************************************************************************\
+ Called when the program quits normally or is killed by a signal and should
+ perform an orderly cleanup.
+\******************************************************************************/
+static void cleanup(void)
+{
+        static int ran_once;
+        int i;
+
+        /* Disable the log event handler */
+        c_log_mode = C_LM_CLEANUP;
+
+        /* It is possible that this function will get called multiple times
+           for certain kinds of exits, do not clean-up twice! */
+        if (ran_once) {
+                C_warning("Cleanup already called");
+                return;
+        }
+        ran_once = TRUE;
+
+        C_status("Cleaning up");
+        N_cleanup();
+        for (i = 0; i < N_CLIENTS_MAX; i++)
+                bot_free(bots + i);
+        SDL_Quit();
+        C_cleanup_lang();
+        C_check_leaks();
+        C_debug("Done");
+}
+
+/******************************************************************************\
+ Caught a signal.
+\******************************************************************************/
+static void signal_handler(int sig)
+{
+        C_warning("Caught signal %d", sig);
+        exit(1);
+}
+
+/******************************************************************************\
+ Start up the bot program from here.
+\******************************************************************************/
+int main(int argc, char *argv[])
+{
+        /* Use the cleanup function instead of lots of atexit() calls to
+           control the order of cleanup */
+        atexit(cleanup);
+
+        /* Set signal handler */
+        C_signal_handler(signal_handler);
+
+        /* Only the common and network namespaces are linked */
+        C_register_variables();
+        N_register_variables();
+        register_variables();
+
+        /* Bots do not share the client's configuration */
+        C_parse_config_file("bots.cfg");
+        parse_config_args(argc, argv);
+        C_open_log_file();
+
+        /* Initialize */
+        C_status("Initializing " PACKAGE_STRING " bots");
+        C_init_lang();
+        C_translate_vars();
+        if (SDL_Init(SDL_INIT_TIMER) < 0)
+                C_error("Failed to initialize SDL: %s", SDL_GetError());
+        N_init();
+
+        /* Connect the bots and run them */
+        C_time_init();
+        main_loop();
+
+        return 0;
+}
@@ -0,0 +1,176 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* This file forms the starting point for the dedicated server program. The
+   server runs the game simulation without a window, OpenGL or the interface
+   and sleeps on the network between fixed update ticks. */
+
+#include "common/c_shared.h"
+#include "network/n_shared.h"
+#include "render/r_shared.h"
+#include "interface/i_shared.h"
+#include "game/g_shared.h"
+
+/******************************************************************************\
+ This is the server's main loop. The game is updated in fixed ticks by the
+ same scheduler the client uses and network traffic is handled while waiting
+ for the next tick.
+\******************************************************************************/
+static void main_loop(void)
+{
+        int tick_msec, wait;
+
+        C_status("Main loop");
+        C_var_unlatch(&g_tick_rate);
+        if (g_tick_rate.value.n < 1)
+                g_tick_rate.value.n = 1;
+        if (g_tick_rate.value.n > 1000)
+                g_tick_rate.value.n = 1000;
+        tick_msec = 1000 / g_tick_rate.value.n;
+        C_debug("Running at %d ticks per second", g_tick_rate.value.n);
+
+        C_rand_seed((unsigned int)time(NULL));
+        while (!c_exit) {
+
+                /* Block on the network until the next tick is due */
+                while ((wait = C_time_to_tick(tick_msec)) > 0)
+                        N_poll_server_wait(wait);
+                C_time_update();
+
+                /* Run every tick that is due */
+                G_update_client();
+                while (C_time_tick(tick_msec, NULL)) {
+                        r_solar_angle -= c_frame_sec * C_PI / 60.f /
+                                         R_MINUTES_PER_DAY;
+                        G_update_tick();
+                }
+
+                /* Hosting failed */
+                if (i_limbo)
+                        C_error("Server is not running");
+
+                /* Transient memory is freed after every wakeup */
+                C_frame_reset();
+        }
+}
+
+/******************************************************************************\
+ Concatenates an argument array and runs it through the config parser.
+\******************************************************************************/
+static void parse_config_args(int argc, char *argv[])
+{
+        int i, len;
+        char buffer[4096], *pos;
+
+        if (argc < 2)
+                return;
+        C_status("Parsing command line");
+        buffer[0] = NUL;
+        pos = buffer;
+        for (i = 1; i < argc; i++) {
+                len = C_strlen(argv[i]);
+                if (pos + len >= buffer + sizeof (buffer)) {
+                        C_warning("Command-line config overflowed");
+                        return;
+                }
+                memcpy(pos, argv[i], len);
+                pos += len;
+                *(pos++) = ' ';
+        }
+        *pos = NUL;
+        C_parse_config_string(buffer);
+}
+
+/******************************************************************************\
+ Called when the program quits normally or is killed by a signal and should
+ perform an orderly cleanup.
+\******************************************************************************/
+static void cleanup(void)
+{
+        static int ran_once;
+
+        /* Disable the log event handler */
+        c_log_mode = C_LM_CLEANUP;
+
+        /* It is possible that this function will get called multiple times
+           for certain kinds of exits, do not clean-up twice! */
+        if (ran_once) {
+                C_warning("Cleanup already called");
+                return;
+        }
+        ran_once = TRUE;
+
+        C_status("Cleaning up");
+        G_cleanup();
+        N_cleanup();
+        SDL_Quit();
+        C_cleanup_lang();
+        C_check_leaks();
+        C_dump_mem_sites(NULL);
+        C_debug("Done");
+}
+
+/******************************************************************************\
+ Caught a signal.
+\******************************************************************************/
+static void signal_handler(int sig)
+{
+        C_warning("Caught signal %d", sig);
+        exit(1);
+}
+
+/******************************************************************************\
+ Start up the server program from here.
+\******************************************************************************/
+int main(int argc, char *argv[])
+{
+        /* Use the cleanup function instead of lots of atexit() calls to
+           control the order of cleanup */
+        atexit(cleanup);
+
+        /* Set signal handler */
+        C_signal_handler(signal_handler);
+
+        /* Only the common, network and game namespaces are linked */
+        C_register_variables();
+        N_register_variables();
+        G_register_variables();
+
+        /* The server does not share the client's configuration */
+        C_parse_config_file("server.cfg");
+        parse_config_args(argc, argv);
+        C_open_log_file();
+
+        /* Run tests if they are enabled */
+        C_endian_check();
+        C_test_mem_check();
+
+        /* Seed the system random number generator */
+        srand((unsigned int)time(NULL));
+
+        /* Initialize */
+        C_status("Initializing " PACKAGE_STRING " server");
+        C_init_lang();
+        C_translate_vars();
+        if (SDL_Init(SDL_INIT_TIMER) < 0)
+                C_error("Failed to initialize SDL: %s", SDL_GetError());
+        N_init();
+        G_init();
+
+        /* Host a game and run it. The server's own client is not a player. */
+        C_time_init();
+        g_headless = TRUE;
+        G_host_game();
+        main_loop();
+
+        return 0;
+}
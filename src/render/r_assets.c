@@ -189,10 +189,25 @@ void R_texture_upload(const r_texture_t *pt)
         surface = pt->surface;
         pow2_surface = NULL;
         if (pt->not_pow2) {
+                SDL_PixelFormat *fmt;
                 SDL_Rect rect;
-
-                pow2_surface = R_surface_alloc(pt->pow2_w, pt->pow2_h,
-                                               pt->alpha);
+                void *pixels;
+                int pitch;
+
+                /* The pixels only need to last until they are uploaded */
+                fmt = &r_sdl_format;
+                pitch = pt->pow2_w * fmt->BytesPerPixel;
+                pixels = C_frame_alloc(pitch * pt->pow2_h);
+                memset(pixels, 0, pitch * pt->pow2_h);
+                pow2_surface = SDL_CreateRGBSurfaceFrom(pixels, pt->pow2_w,
+                                                        pt->pow2_h,
+                                                        fmt->BitsPerPixel,
+                                                        pitch, fmt->Rmask,
+                                                        fmt->Gmask, fmt->Bmask,
+                                                        fmt->Amask);
+                if (!pow2_surface)
+                        C_error("Failed to allocate temporary texture "
+                                "surface");
                 rect.x = 0;
                 rect.y = 0;
                 rect.w = pt->surface->w;
@@ -228,8 +243,13 @@ void R_texture_upload(const r_texture_t *pt)
                              surface->w, surface->h, 0,
                              GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
 
-        /* Free the temporary surface if we used it */
-        R_surface_free(pow2_surface);
+        /* Free the temporary surface if we used it. Textures can be
+           uploaded many at a time outside of the main loop, so give the
+           pixels back to the frame arena right away. */
+        if (pow2_surface) {
+                C_frame_release(pow2_surface->pixels);
+                SDL_FreeSurface(pow2_surface);
+        }
 
         R_check_errors();
 }
@@ -701,10 +721,17 @@ static void vbo_upload(r_vbo_t *vbo)
 }
 
 /******************************************************************************\
- Bind and render a vertex buffer object.
+ Bind and render part of a vertex buffer object. Renders [len] indices
+ starting from index [index_first], which are relative to vertex
+ [vertex_first]. If the buffer has no indices, [len] vertices starting from
+ [vertex_first] are rendered instead. This lets a single buffer hold many
+ meshes.
 \******************************************************************************/
-void R_vbo_render(r_vbo_t *vbo)
+void R_vbo_render_range(r_vbo_t *vbo, int vertex_first, int index_first,
+                        int len)
 {
+        size_t vertex_offset;
+
 #ifdef WINDOWS
         /* Windows will lose everything in video memory if the resolution is
            changed, so we need to check for this and reupload */
@@ -712,16 +739,19 @@ void R_vbo_render(r_vbo_t *vbo)
                 vbo_upload(vbo);
 #endif
 
+        vertex_offset = (size_t)vertex_first * vbo->vertex_size;
+
         /* Use vertex buffer objects if supported */
         if (r_ext.vertex_buffers) {
                 r_ext.glBindBuffer(GL_ARRAY_BUFFER, vbo->vertices_name);
                 r_ext.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo->indices_name);
-                glInterleavedArrays(vbo->vertex_format, vbo->vertex_size, NULL);
+                glInterleavedArrays(vbo->vertex_format, vbo->vertex_size,
+                                    (char *)NULL + vertex_offset);
                 if (vbo->indices)
-                        glDrawElements(GL_TRIANGLES, vbo->indices_len,
-                                       GL_UNSIGNED_SHORT, NULL);
+                        glDrawElements(GL_TRIANGLES, len, GL_UNSIGNED_SHORT,
+                                       (unsigned short *)NULL + index_first);
                 else
-                        glDrawArrays(GL_TRIANGLES, 0, vbo->vertices_len);
+                        glDrawArrays(GL_TRIANGLES, 0, len);
                 r_ext.glBindBuffer(GL_ARRAY_BUFFER, 0);
                 r_ext.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         }
@@ -729,12 +759,13 @@ void R_vbo_render(r_vbo_t *vbo)
         /* Otherwise just make the rendering calls */
         else {
                 glInterleavedArrays(vbo->vertex_format, vbo->vertex_size,
-                                    vbo->vertices);
+                                    (char *)vbo->vertices + vertex_offset);
                 if (vbo->indices)
-                        glDrawElements(GL_TRIANGLES, vbo->indices_len,
-                                       GL_UNSIGNED_SHORT, vbo->indices);
+                        glDrawElements(GL_TRIANGLES, len, GL_UNSIGNED_SHORT,
+                                       (unsigned short *)vbo->indices +
+                                       index_first);
                 else
-                        glDrawArrays(GL_TRIANGLES, 0, vbo->vertices_len);
+                        glDrawArrays(GL_TRIANGLES, 0, len);
         }
 
         /* Make sure these are off after the interleaved array calls */
@@ -745,6 +776,15 @@ void R_vbo_render(r_vbo_t *vbo)
         R_check_errors();
 }
 
+/******************************************************************************\
+ Bind and render a vertex buffer object.
+\******************************************************************************/
+void R_vbo_render(r_vbo_t *vbo)
+{
+        R_vbo_render_range(vbo, 0, 0, vbo->indices ? vbo->indices_len :
+                                                     vbo->vertices_len);
+}
+
 /******************************************************************************\
  Cleanup a vertex buffer object.
 \******************************************************************************/
@@ -128,6 +128,7 @@ void R_vbo_cleanup(r_vbo_t *);
 void R_vbo_init(r_vbo_t *, void *vertices, int vertices_len, int vertex_size,
                 int vertex_format, void *indices, int indices_len);
 void R_vbo_render(r_vbo_t *);
+void R_vbo_render_range(r_vbo_t *, int vertex_first, int index_first, int len);
 void R_vbo_update(r_vbo_t *);
 
 extern r_texture_t *r_terrain_tex, *r_white_tex;
@@ -190,9 +191,12 @@ void R_surface_put(SDL_Surface *, int x, int y, c_color_t);
 int R_surface_save(SDL_Surface *, const char *filename);
 
 /* r_terrain.c */
-extern r_globe_vertex_t r_globe_verts[R_TILES_MAX * 3];
 extern r_vbo_t r_globe_vbo;
 
+/* r_tiles.c */
+extern r_globe_vertex_t r_globe_verts[R_TILES_MAX * 3];
+extern int r_flip_limit;
+
 /* r_test.c */
 void R_render_normals(int count, c_vec3_t *co, c_vec3_t *no, int stride);
 void R_render_tests(void);
@@ -201,9 +205,9 @@ void R_render_tests(void);
 extern c_var_t r_clear, r_depth_bits, r_ext_point_sprites, r_globe,
                r_globe_colors[3], r_atmosphere, r_globe_shininess,
                r_globe_smooth, r_globe_transitions, r_gl_errors, r_light,
-               r_light_ambient, r_model_lod, r_moon_atten, r_moon_diffuse,
-               r_moon_height, r_moon_specular, r_screenshots_dir, r_solar,
-               r_sun_diffuse, r_sun_specular, r_test_normals, r_test_sprite_num,
-               r_test_sprite, r_test_model, r_test_prerender, r_test_text,
-               r_textures, r_vsync;
+               r_light_ambient, r_model_cache, r_model_compile, r_model_lod,
+               r_moon_atten, r_moon_diffuse, r_moon_height, r_moon_specular,
+               r_screenshots_dir, r_solar, r_sun_diffuse, r_sun_specular,
+               r_test_normals, r_test_sprite_num, r_test_sprite, r_test_model,
+               r_test_prerender, r_test_text, r_textures, r_vsync;
 
@@ -15,12 +15,18 @@
 
 #include "r_common.h"
 
-/* Non-animated mesh */
+/* Compiled model cache file header magic and format version. The version
+   must be bumped whenever the layout of the cache file changes. */
+#define CACHE_MAGIC 0x4d554c50
+#define CACHE_VERSION 1
+
+/* Non-animated mesh. Parsed meshes are built in the frame arena. Once the
+   model is uploaded, the vertex and index arrays point into the model's
+   shared arrays starting at [verts_first] and [indices_first]. */
 typedef struct r_mesh {
-        r_vbo_t vbo;
         r_vertex3_t *verts;
         unsigned short *indices;
-        int verts_len, indices_len;
+        int verts_len, indices_len, verts_first, indices_first;
 } mesh_t;
 
 /* Model animation type */
@@ -32,30 +38,51 @@ typedef struct model_anim {
 /* Model object type */
 typedef struct model_object {
         r_texture_t *texture;
-        char name[64];
+        char name[64], texture_name[128];
 } model_object_t;
 
 /* Animated, textured, multi-mesh model. The matrix contains enough room to
    store every object's static mesh for every frame, it is indexed by frame
-   then by object. */
+   then by object. Models loaded from the cache keep their mesh data in a
+   single [blob] until they are uploaded. All of the meshes are then packed
+   into the [verts] and [indices] arrays and share a single vertex buffer
+   object. */
 typedef struct r_model_data {
         c_ref_t ref;
+        r_vbo_t vbo;
+        r_vertex3_t *verts;
         mesh_t *matrix;
         model_anim_t *anims;
         model_object_t *objects;
+        unsigned short *indices;
+        char *blob;
         int anims_len, objects_len, frames;
 } model_data_t;
 
+/* Compiled model cache file header. It is followed by [size] bytes holding
+   the animations, the object names and textures, then the vertex and index
+   counts and arrays of each mesh in matrix order. */
+typedef struct cache_header {
+        int magic, version, size, frames, objects_len, anims_len;
+        float lod;
+} cache_header_t;
+
+/* Compiled model cache object record */
+typedef struct cache_object {
+        char name[64], texture_name[128];
+} cache_object_t;
+
 /* Linked list of loaded model data */
 static c_ref_t *data_root;
 
 /******************************************************************************\
- Render a mesh.
+ Render a mesh out of the model's vertex buffer object.
 \******************************************************************************/
-static void mesh_render(mesh_t *mesh)
+static void mesh_render(model_data_t *data, mesh_t *mesh)
 {
         C_count_add(&r_count_faces, mesh->indices_len / 3);
-        R_vbo_render(&mesh->vbo);
+        R_vbo_render_range(&data->vbo, mesh->verts_first,
+                           mesh->indices_first, mesh->indices_len);
 
         /* Render the mesh normals for testing */
         R_render_normals(mesh->verts_len, &mesh->verts[0].co,
@@ -63,20 +90,8 @@ static void mesh_render(mesh_t *mesh)
 }
 
 /******************************************************************************\
- Release the resources for a mesh.
-\******************************************************************************/
-static void mesh_cleanup(mesh_t *mesh)
-{
-        if (!mesh)
-                return;
-        C_free(mesh->verts);
-        C_free(mesh->indices);
-        R_vbo_cleanup(&mesh->vbo);
-}
-
-/******************************************************************************\
- Finish parsing an object and creates the mesh object. If Vertex Buffer Objects
- are supported, a new buffer is allocated and the vertex data is uploaded.
+ Finish parsing an object and store its vertices and indices in the mesh
+ matrix.
 \******************************************************************************/
 static int finish_object(model_data_t *data, int frame, int object,
                          c_array_t *verts, c_array_t *indices)
@@ -104,12 +119,6 @@ static int finish_object(model_data_t *data, int frame, int object,
                           data->objects[object].name, frame);
                 return FALSE;
         }
-
-        /* Meshes are rendered through vertex buffer objects */
-        R_vbo_init(&mesh->vbo, mesh->verts, mesh->verts_len,
-                   sizeof (*mesh->verts), R_VERTEX3_FORMAT,
-                   mesh->indices, mesh->indices_len);
-
         return TRUE;
 }
 
@@ -122,15 +131,15 @@ static void model_data_cleanup(model_data_t *data)
 
         if (!data)
                 return;
-        if (data->matrix) {
-                for (i = 0; i < data->objects_len * data->frames; i++)
-                        mesh_cleanup(data->matrix + i);
-                C_free(data->matrix);
-        }
+        R_vbo_cleanup(&data->vbo);
+        C_free(data->matrix);
+        C_free(data->verts);
+        C_free(data->indices);
         for (i = 0; i < data->objects_len; i++)
                 R_texture_free(data->objects[i].texture);
         C_free(data->objects);
         C_free(data->anims);
+        C_free(data->blob);
 }
 
 /******************************************************************************\
@@ -171,24 +180,16 @@ static int add_face(const void *p, unsigned short indices[3], c_array_t *array,
 }
 
 /******************************************************************************\
- Allocate memory for and load model data and its textures. Data is cached so
- calling this function again will return and reference the cached data.
+ Parse a text PLUM file into [data]. Textures and vertex buffers are not
+ loaded here. Returns FALSE if the file could not be parsed.
 \******************************************************************************/
-static model_data_t *model_data_load(const char *filename, bool cull)
+static int model_data_parse(model_data_t *data, const char *filename,
+                            bool cull)
 {
         c_token_file_t token_file;
         c_array_t anims, objects, verts, indices;
-        model_data_t *data;
         const char *token;
-        int found, quoted, object, frame, verts_parsed, faces_culled;
-
-        if (!filename || !filename[0])
-                return NULL;
-        data = C_ref_alloc(sizeof (*data), &data_root,
-                           (c_ref_cleanup_f)model_data_cleanup,
-                           filename, &found);
-        if (found)
-                return data;
+        int quoted, object, frame, verts_parsed, faces_culled;
 
         /* Start parsing the file */
         C_zero(&verts);
@@ -247,7 +248,8 @@ static model_data_t *model_data_load(const char *filename, bool cull)
                 token = C_token_file_read(&token_file);
                 C_strncpy(obj.name, token, sizeof (obj.name));
                 token = C_token_file_read(&token_file);
-                obj.texture = R_texture_load(token, TRUE);
+                C_strncpy(obj.texture_name, token, sizeof (obj.texture_name));
+                obj.texture = NULL;
                 C_array_append(&objects, &obj);
         }
         data->objects_len = objects.len;
@@ -288,8 +290,8 @@ static model_data_t *model_data_load(const char *filename, bool cull)
                         if (!finish_object(data, frame, object++,
                                            &verts, &indices))
                                 goto error;
-                        C_array_init(&verts, r_vertex3_t, 512);
-                        C_array_init(&indices, unsigned short, 512);
+                        C_array_init_frame(&verts, r_vertex3_t, 512);
+                        C_array_init_frame(&indices, unsigned short, 512);
                         verts_parsed = 0;
                         if (object > data->objects_len) {
                                 C_warning("PLUM file '%s' frame %d has too"
@@ -370,17 +372,348 @@ static model_data_t *model_data_load(const char *filename, bool cull)
         }
 
         C_token_file_cleanup(&token_file);
-        C_debug("Loaded '%s' (%d frm, %d obj, %d anim)",
-                filename, data->frames, data->objects_len, data->anims_len);
         if (faces_culled > 0)
                 C_debug("Culled %d faces total", faces_culled);
-        return data;
+        return TRUE;
 
 error:  C_token_file_cleanup(&token_file);
         C_array_cleanup(&verts);
         C_array_cleanup(&indices);
-        C_ref_down(&data->ref);
-        return NULL;
+        return FALSE;
+}
+
+/******************************************************************************\
+ Returns the path of the compiled cache file for model [filename], relative to
+ the user's directory.
+\******************************************************************************/
+static const char *cache_name(const char *filename)
+{
+        char buffer[256], *pos;
+
+        C_strncpy_buf(buffer, filename);
+        for (pos = buffer; *pos; pos++)
+                if (*pos == '/' || *pos == '\\' || *pos == ':')
+                        *pos = '_';
+        return C_va("cache/%s.bin", buffer);
+}
+
+/******************************************************************************\
+ Returns the modification time of [path] or its gz-compressed version.
+\******************************************************************************/
+static int file_time(const char *path)
+{
+        int time;
+
+        if ((time = C_modified_time(path)) >= 0)
+                return time;
+        return C_modified_time(C_va("%s.gz", path));
+}
+
+/******************************************************************************\
+ Returns the modification time of a model source file, searching the same
+ directories as C_file_init_read(). Returns negative if it is not found.
+\******************************************************************************/
+static int source_time(const char *filename)
+{
+        int time;
+
+        if (!C_absolute_path(filename) &&
+            (time = file_time(C_va("%s/%s", C_user_dir(), filename))) >= 0)
+                return time;
+        if ((time = file_time(filename)) >= 0)
+                return time;
+        return file_time(C_va("%s/%s", C_app_dir(), filename));
+}
+
+/******************************************************************************\
+ Try to load model [data] from its compiled cache file. The cache is only
+ used if it is newer than the source file and was compiled with the same
+ level-of-detail setting. Mesh arrays point into a single allocated blob.
+ Returns FALSE if the cache could not be used.
+\******************************************************************************/
+static int cache_read(model_data_t *data, const char *filename, float lod)
+{
+        c_file_t file;
+        cache_header_t header;
+        cache_object_t *cobj;
+        const char *path;
+        char *pos, *end;
+        int i, cache_time, src_time;
+
+        path = cache_name(filename);
+        if ((cache_time = C_modified_time(C_va("%s/%s", C_user_dir(),
+                                               path))) < 0 ||
+            (src_time = source_time(filename)) < 0 || cache_time <= src_time)
+                return FALSE;
+        if (!C_file_init_read(&file, path))
+                return FALSE;
+        if (C_file_read(&file, (char *)&header, sizeof (header)) !=
+            sizeof (header) || header.magic != CACHE_MAGIC ||
+            header.version != CACHE_VERSION || header.lod != lod ||
+            header.size < 0 || header.frames < 0 || header.objects_len < 0 ||
+            header.anims_len < 0) {
+                C_file_cleanup(&file);
+                return FALSE;
+        }
+
+        /* Read the rest of the file in one go */
+        data->blob = C_malloc(header.size);
+        if (C_file_read(&file, data->blob, header.size) != header.size) {
+                C_warning("Model cache '%s' is truncated", path);
+                C_file_cleanup(&file);
+                goto error;
+        }
+        C_file_cleanup(&file);
+        pos = data->blob;
+        end = data->blob + header.size;
+
+        /* Animations */
+        if (pos + header.anims_len * sizeof (model_anim_t) > end)
+                goto corrupt;
+        data->anims_len = header.anims_len;
+        data->anims = C_malloc(header.anims_len * sizeof (model_anim_t));
+        memcpy(data->anims, pos, header.anims_len * sizeof (model_anim_t));
+        pos += header.anims_len * sizeof (model_anim_t);
+
+        /* Objects */
+        if (pos + header.objects_len * sizeof (cache_object_t) > end)
+                goto corrupt;
+        data->objects_len = header.objects_len;
+        data->objects = C_calloc(header.objects_len * sizeof (model_object_t));
+        for (i = 0; i < header.objects_len; i++) {
+                cobj = (cache_object_t *)pos;
+                C_strncpy_buf(data->objects[i].name, cobj->name);
+                C_strncpy_buf(data->objects[i].texture_name,
+                              cobj->texture_name);
+                pos += sizeof (*cobj);
+        }
+
+        /* Meshes */
+        data->frames = header.frames;
+        data->matrix = C_calloc(data->frames * data->objects_len *
+                                sizeof (mesh_t));
+        for (i = 0; i < data->frames * data->objects_len; i++) {
+                mesh_t *mesh;
+
+                mesh = data->matrix + i;
+                if (pos + 2 * sizeof (int) > end)
+                        goto corrupt;
+                mesh->verts_len = ((int *)pos)[0];
+                mesh->indices_len = ((int *)pos)[1];
+                pos += 2 * sizeof (int);
+                if (mesh->verts_len < 0 || mesh->indices_len < 0 ||
+                    pos + mesh->verts_len * sizeof (r_vertex3_t) +
+                    mesh->indices_len * sizeof (unsigned short) > end)
+                        goto corrupt;
+                mesh->verts = (r_vertex3_t *)pos;
+                pos += mesh->verts_len * sizeof (r_vertex3_t);
+                mesh->indices = (unsigned short *)pos;
+                pos += (mesh->indices_len * sizeof (unsigned short) + 3) & ~3;
+        }
+        return TRUE;
+
+corrupt:
+        C_warning("Model cache '%s' is corrupt", path);
+error:  model_data_cleanup(data);
+        data->matrix = NULL;
+        data->anims = NULL;
+        data->objects = NULL;
+        data->blob = NULL;
+        data->anims_len = data->objects_len = data->frames = 0;
+        return FALSE;
+}
+
+/******************************************************************************\
+ Write model [data] to its compiled cache file. Returns FALSE if the cache
+ file could not be written.
+\******************************************************************************/
+static int cache_write(const model_data_t *data, const char *filename,
+                       float lod)
+{
+        c_file_t file;
+        cache_header_t header;
+        cache_object_t cobj;
+        const char *path;
+        int i, len, written, pad;
+
+        C_mkdir(C_va("%s/cache", C_user_dir()));
+        path = C_va("%s/%s", C_user_dir(), cache_name(filename));
+        if (!C_file_init_write(&file, path)) {
+                C_warning("Failed to write model cache '%s'", path);
+                return FALSE;
+        }
+
+        /* Header */
+        header.magic = CACHE_MAGIC;
+        header.version = CACHE_VERSION;
+        header.frames = data->frames;
+        header.objects_len = data->objects_len;
+        header.anims_len = data->anims_len;
+        header.lod = lod;
+        header.size = data->anims_len * sizeof (model_anim_t) +
+                      data->objects_len * sizeof (cache_object_t);
+        for (i = 0; i < data->frames * data->objects_len; i++)
+                header.size += 2 * sizeof (int) +
+                               data->matrix[i].verts_len *
+                               sizeof (r_vertex3_t) +
+                               ((data->matrix[i].indices_len *
+                                 sizeof (unsigned short) + 3) & ~3);
+        written = C_file_write(&file, (char *)&header, sizeof (header));
+
+        /* Animations and objects */
+        written += C_file_write(&file, (char *)data->anims,
+                                data->anims_len * sizeof (model_anim_t));
+        for (i = 0; i < data->objects_len; i++) {
+                C_zero(&cobj);
+                C_strncpy_buf(cobj.name, data->objects[i].name);
+                C_strncpy_buf(cobj.texture_name,
+                              data->objects[i].texture_name);
+                written += C_file_write(&file, (char *)&cobj, sizeof (cobj));
+        }
+
+        /* Meshes, index arrays are padded to keep vertices aligned */
+        for (i = 0; i < data->frames * data->objects_len; i++) {
+                const mesh_t *mesh;
+                int counts[2];
+
+                mesh = data->matrix + i;
+                counts[0] = mesh->verts_len;
+                counts[1] = mesh->indices_len;
+                written += C_file_write(&file, (char *)counts,
+                                        sizeof (counts));
+                written += C_file_write(&file, (char *)mesh->verts,
+                                        mesh->verts_len * sizeof (r_vertex3_t));
+                len = mesh->indices_len * sizeof (unsigned short);
+                written += C_file_write(&file, (char *)mesh->indices, len);
+                pad = 0;
+                written += C_file_write(&file, (char *)&pad,
+                                        ((len + 3) & ~3) - len);
+        }
+        C_file_cleanup(&file);
+        if (written != (int)sizeof (header) + header.size) {
+                C_warning("Failed to write model cache '%s'", path);
+                return FALSE;
+        }
+        return TRUE;
+}
+
+/******************************************************************************\
+ Load the textures for model [data], pack its meshes into one vertex and
+ index array and upload them into a single vertex buffer object that is
+ shared by every instance of the model.
+\******************************************************************************/
+static void model_data_upload(model_data_t *data)
+{
+        mesh_t *mesh;
+        int i, meshes, verts_len, indices_len;
+
+        for (i = 0; i < data->objects_len; i++)
+                data->objects[i].texture =
+                        R_texture_load(data->objects[i].texture_name, TRUE);
+
+        /* Pack the meshes */
+        meshes = data->frames * data->objects_len;
+        for (verts_len = indices_len = i = 0; i < meshes; i++) {
+                verts_len += data->matrix[i].verts_len;
+                indices_len += data->matrix[i].indices_len;
+        }
+        data->verts = C_malloc(verts_len * sizeof (*data->verts) + 1);
+        data->indices = C_malloc(indices_len * sizeof (*data->indices) + 1);
+        for (verts_len = indices_len = i = 0; i < meshes; i++) {
+                mesh = data->matrix + i;
+                memcpy(data->verts + verts_len, mesh->verts,
+                       mesh->verts_len * sizeof (*mesh->verts));
+                memcpy(data->indices + indices_len, mesh->indices,
+                       mesh->indices_len * sizeof (*mesh->indices));
+                mesh->verts = data->verts + verts_len;
+                mesh->indices = data->indices + indices_len;
+                mesh->verts_first = verts_len;
+                mesh->indices_first = indices_len;
+                verts_len += mesh->verts_len;
+                indices_len += mesh->indices_len;
+        }
+        C_free(data->blob);
+        data->blob = NULL;
+
+        R_vbo_init(&data->vbo, data->verts, verts_len, sizeof (*data->verts),
+                   R_VERTEX3_FORMAT, data->indices, indices_len);
+}
+
+/******************************************************************************\
+ Allocate memory for and load model data and its textures. Data is cached so
+ calling this function again will return and reference the cached data.
+ Parsed models are compiled into the user's cache directory, and the compiled
+ form is loaded instead of the text file when it is up to date.
+\******************************************************************************/
+static model_data_t *model_data_load(const char *filename, bool cull)
+{
+        model_data_t *data;
+        unsigned int start_msec;
+        float lod;
+        int found, cached;
+
+        if (!filename || !filename[0])
+                return NULL;
+        data = C_ref_alloc(sizeof (*data), &data_root,
+                           (c_ref_cleanup_f)model_data_cleanup,
+                           filename, &found);
+        if (found)
+                return data;
+        start_msec = SDL_GetTicks();
+        lod = cull ? r_model_lod.value.f : 0.f;
+        cached = r_model_cache.value.n && cache_read(data, filename, lod);
+        if (!cached) {
+                if (!model_data_parse(data, filename, cull)) {
+                        C_ref_down(&data->ref);
+                        return NULL;
+                }
+                if (r_model_cache.value.n)
+                        cache_write(data, filename, lod);
+        }
+        model_data_upload(data);
+        C_debug("Loaded '%s' (%d frm, %d obj, %d anim) %sin %d msec",
+                filename, data->frames, data->objects_len, data->anims_len,
+                cached ? "from cache " : "", SDL_GetTicks() - start_msec);
+        return data;
+}
+
+/******************************************************************************\
+ Compile each model listed in [r_model_compile] into the cache, regardless of
+ whether the cache is up to date. Returns TRUE if any models were listed, in
+ which case the program is expected to exit.
+\******************************************************************************/
+bool R_compile_models(void)
+{
+        c_token_file_t token_file;
+        model_data_t *data;
+        const char *token;
+        unsigned int start_msec;
+        int quoted, compiled, failed;
+
+        if (!r_model_compile.value.s[0])
+                return FALSE;
+        C_status("Compiling models");
+        start_msec = SDL_GetTicks();
+        compiled = failed = 0;
+        C_token_file_init_string(&token_file, r_model_compile.value.s);
+        for (token = C_token_file_read_full(&token_file, &quoted);
+             token[0] || quoted;
+             token = C_token_file_read_full(&token_file, &quoted)) {
+                data = C_calloc(sizeof (*data));
+                C_strncpy_buf(data->ref.name, token);
+                if (model_data_parse(data, token, TRUE) &&
+                    cache_write(data, token, r_model_lod.value.f)) {
+                        C_debug("Compiled '%s'", token);
+                        compiled++;
+                } else
+                        failed++;
+                model_data_cleanup(data);
+                C_free(data);
+        }
+        C_token_file_cleanup(&token_file);
+        C_debug("Compiled %d model(s), %d failed, in %d msec",
+                compiled, failed, SDL_GetTicks() - start_msec);
+        return TRUE;
 }
 
 /******************************************************************************\
@@ -575,7 +908,7 @@ void R_model_render(r_model_t *model)
                 /* Render model meshes */
                 for (i = 0; i < model->data->objects_len; i++) {
                         R_texture_select(model->data->objects[i].texture);
-                        mesh_render(meshes + i);
+                        mesh_render(model->data, meshes + i);
                 }
 
                 glColor4f(1.f, 1.f, 1.f, 1.f);
@@ -588,7 +921,7 @@ void R_model_render(r_model_t *model)
         else
                 for (i = 0; i < model->data->objects_len; i++) {
                         R_texture_select(model->data->objects[i].texture);
-                        mesh_render(meshes + i);
+                        mesh_render(model->data, meshes + i);
                 }
 
         R_gl_restore();
@@ -227,8 +227,9 @@ void R_sprite_init_text(r_sprite_t *sprite, r_font_t font, float wrap,
                         float shadow, int invert, const char *string)
 {
         r_texture_t *tex;
-        int i, j, y, last_break, last_line, width, height, line_skip, char_len;
-        char buf[1024], *line;
+        int i, j, y, last_break, last_line, width, height, line_skip, char_len,
+            buf_size;
+        char *buf, *line;
 
         if (font < 0 || font >= R_FONTS)
                 C_error("Invalid font index %d", font);
@@ -240,7 +241,10 @@ void R_sprite_init_text(r_sprite_t *sprite, r_font_t font, float wrap,
 
         /* Wrap the text and figure out how large the surface needs to be. The
            width and height also need to be expanded by a pixel to leave room
-           for the shadow (up to 2 pixels). */
+           for the shadow (up to 2 pixels). Every character can start a new
+           line, so the wrapped text is at most twice as long. */
+        buf_size = 2 * C_strlen(string) + 2;
+        buf = C_frame_alloc(buf_size);
         wrap *= r_scale_2d;
         last_line = 0;
         last_break = 0;
@@ -250,7 +254,8 @@ void R_sprite_init_text(r_sprite_t *sprite, r_font_t font, float wrap,
         for (i = 0, j = 0; ; i += char_len) {
                 c_vec2_t size;
 
-                char_len = C_utf8_append(buf, &j, sizeof (buf) - 1, string + i);
+                char_len = C_utf8_append(buf, &j, buf_size - 1,
+                                         string + i);
                 buf[j] = NUL;
                 if (!char_len)
                         break;
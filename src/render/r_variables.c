@@ -23,6 +23,9 @@ c_var_t r_globe, r_test_normals, r_test_model, r_test_prerender, r_test_sprite,
 /* Effects parameters */
 c_var_t r_atmosphere, r_globe_smooth, r_globe_transitions, r_model_lod;
 
+/* Model cache */
+c_var_t r_model_cache, r_model_compile;
+
 /* Lighting parameters */
 c_var_t r_globe_colors[3], r_globe_shininess, r_light, r_light_ambient,
         r_moon_atten, r_moon_diffuse, r_moon_height, r_moon_specular, r_solar,
@@ -102,6 +105,13 @@ void R_register_variables(void)
         C_register_float(&r_model_lod, "r_model_lod", 1.f,
                          "model level-of-detail: 0.0-...");
 
+        /* Model cache */
+        C_register_integer(&r_model_cache, "r_model_cache", TRUE,
+                           "load and save compiled models in the user dir");
+        C_register_string(&r_model_compile, "r_model_compile", "",
+                          "compile these models into the cache and quit");
+        r_model_compile.archive = FALSE;
+
         /* Lighting parameters */
         C_register_integer(&r_light, "r_light", TRUE,
                           "enable light from the sun and moon");
@@ -0,0 +1,216 @@
+/******************************************************************************\
+ Plutocracy - Copyright (C) 2008 - Michael Levin
+
+ This program is free software; you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation; either version 2, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+\******************************************************************************/
+
+/* The dedicated server links the game namespace without the render and
+   interface namespaces. This file stands in for the parts of them that the
+   game calls. Globe tiles come from the real render/r_tiles.c. */
+
+#include "../common/c_shared.h"
+#include "../render/r_shared.h"
+#include "../interface/i_shared.h"
+
+/* Render state read by the game */
+c_vec3_t r_cam_forward, r_cam_origin;
+c_color_t r_fog_color;
+float r_solar_angle;
+
+/* Interface state read by the game */
+int i_limbo;
+
+/******************************************************************************\
+ Globe generation only needs the tile geometry.
+\******************************************************************************/
+void R_generate_globe(int subdiv4)
+{
+        R_generate_tiles(subdiv4);
+}
+
+void R_configure_globe(void)
+{
+        R_configure_tiles();
+}
+
+/******************************************************************************\
+ Models are never loaded or rendered.
+\******************************************************************************/
+int R_model_init(r_model_t *model, const char *filename, bool cull)
+{
+        C_zero(model);
+        model->scale = 1.f;
+        return TRUE;
+}
+
+void R_model_cleanup(r_model_t *model)
+{
+}
+
+void R_model_render(r_model_t *model)
+{
+}
+
+/******************************************************************************\
+ Rendering and camera calls do nothing.
+\******************************************************************************/
+void R_adjust_light_for(c_vec3_t origin)
+{
+}
+
+void R_fill_screen(c_color_t color)
+{
+}
+
+void R_finish_globe(void)
+{
+}
+
+void R_hover_tile(int tile, r_select_type_t type)
+{
+}
+
+void R_render_border(int tile, c_color_t color)
+{
+}
+
+void R_render_ship_boarding(c_vec3_t origin_a, c_vec3_t origin_b,
+                            c_color_t color)
+{
+}
+
+void R_render_ship_status(const r_model_t *model, float left, float left_max,
+                          float right, float right_max, c_color_t modulate,
+                          bool selected, bool own)
+{
+}
+
+void R_render_test_line(c_vec3_t from, c_vec3_t to, c_color_t color)
+{
+}
+
+void R_rotate_cam_to(c_vec3_t origin)
+{
+}
+
+void R_select_path(int tile, const char *path)
+{
+}
+
+void R_select_tile(int tile, r_select_type_t type)
+{
+}
+
+void R_start_globe(void)
+{
+}
+
+/******************************************************************************\
+ Messages meant for the player are logged instead.
+\******************************************************************************/
+void I_popup(c_vec3_t *goto_pos, const char *message)
+{
+        C_debug("%s", message);
+}
+
+void I_print_chat(const char *name, i_color_t color, const char *message)
+{
+        if (name && name[0])
+                C_debug("%s: %s", name, message);
+        else
+                C_debug("%s", message);
+}
+
+/******************************************************************************\
+ The game enters limbo when hosting fails or the server disconnects.
+\******************************************************************************/
+void I_enter_limbo(void)
+{
+        i_limbo = TRUE;
+}
+
+void I_leave_limbo(void)
+{
+        i_limbo = FALSE;
+}
+
+/******************************************************************************\
+ There are no windows, rings or player lists to update.
+\******************************************************************************/
+void I_add_server(const char *main, const char *alt, const char *address,
+                  bool compatible)
+{
+}
+
+void I_add_to_ring(i_ring_icon_t icon, int enabled, const char *label,
+                   const char *sub_label)
+{
+}
+
+void I_configure_cargo(int index, const i_cargo_info_t *info)
+{
+}
+
+void I_configure_player(int index, const char *name, i_color_t color,
+                        bool host)
+{
+}
+
+void I_configure_player_num(int num)
+{
+}
+
+void I_disable_trade(void)
+{
+}
+
+void I_enable_nation(int nation, bool enable)
+{
+}
+
+void I_enable_trade(bool left_own, const char *partner, int used, int capacity)
+{
+}
+
+void I_quick_info_add(const char *label, const char *value)
+{
+}
+
+void I_quick_info_add_color(const char *label, const char *value,
+                            i_color_t color)
+{
+}
+
+void I_quick_info_close(void)
+{
+}
+
+void I_quick_info_show(const char *title, const c_vec3_t *goto_pos)
+{
+}
+
+void I_reset_ring(void)
+{
+}
+
+void I_reset_servers(void)
+{
+}
+
+void I_select_nation(int nation)
+{
+}
+
+void I_show_ring(i_ring_f callback)
+{
+}
+
+void I_update_colors(void)
+{
+}